@@ -125,7 +125,8 @@ void AnalyzeProtonEvent(std::string hitsFilename)
   while (myReader.Next()) {
     // Just access the data as if myEnergyDeposit, etc were iterators (note the '*'
     //   in front of them):
-    if (*myParticleType > 0) {
+    // ParticleType codes: 0 proton, 1-3 phonons, 4 and up other species
+    if (*myParticleType >= 1 && *myParticleType <= 3) {
       phonon_eDep->Fill(*myEnergyDeposit);
       phonon_hitXY->Fill(*myPositionX, *myPositionY);
       phonon_hitYZ->Fill(*myPositionY, *myPositionZ);
@@ -151,7 +152,7 @@ void AnalyzeProtonEvent(std::string hitsFilename)
         phononTF_hitXZ->Fill(*myPositionX, *myPositionZ);
         phononTF_hitTime->Fill(*myTime);
       }
-    } else {
+    } else if (*myParticleType == 0) {
       proton_eDep->Fill(*myEnergyDeposit);
       proton_hitXY->Fill(*myPositionX, *myPositionY);
       proton_hitYZ->Fill(*myPositionY, *myPositionZ);
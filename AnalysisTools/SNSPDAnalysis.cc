@@ -0,0 +1,291 @@
+//---------------------------------------------------------
+//
+// SNSPDAnalysis.cc
+//
+// Compiled, multithreaded version of AnalyzeProtonEvent in
+// SMSPD_sim_Analysis.cc.  Every input's Hits tree is read
+// once, in parallel over its clusters (TTreeProcessorMT);
+// each thread fills its own copies of the 25 histograms
+// (eDep, XY, YZ, XZ and time for proton, all phonons,
+// phononL, phononTS and phononTF), which are merged at the
+// end.  For each input it writes the same two PDFs as the
+// macro and saves the histograms to
+// <outdir>/<input stem>_AnalysisOutput.root:
+//
+//   SNSPDAnalysis [-j threads] [-o outdir] [file.root ...]
+//
+// Without files, every Results/*.root is analyzed.  Zero
+// threads (the default) lets ROOT use all cores.
+//
+//---------------------------------------------------------
+
+//C++ includes
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <glob.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+//ROOT includes
+#include "ROOT/TThreadedObject.hxx"
+#include "ROOT/TTreeProcessorMT.hxx"
+#include "TCanvas.h"
+#include "TColor.h"
+#include "TFile.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TLegend.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+
+//---------------------------------------------------------------------------------------
+// Binning of AnalyzeProtonEvent
+namespace {
+  const int nBinsEDep = 200;
+  const double eDepMin = 0., eDepMax = 0.08;
+  const int nBinsX = 200, nBinsY = 200, nBinsZ = 210;
+  const double sensorMinX = -0.5, sensorMaxX = 0.5;
+  const double sensorMinY = -0.5, sensorMaxY = 0.5;
+  const double sensorMinZ = -1.6, sensorMaxZ = -0.9;
+  const int nBinsTime = 200;
+  const double minTime = 0., maxTime = 20.;
+
+  enum Group { kProton, kPhonon, kPhononL, kPhononTS, kPhononTF, kNGroups };
+  const char* groupNames[kNGroups] = { "proton", "phonon", "phononL", "phononTS", "phononTF" };
+  const Color_t groupColors[kNGroups] = { kRed, kBlue, kMagenta, kCyan, kYellow };
+
+  // Groups each ParticleType fills (see include/ParticleCode.hh), so the
+  // entry loop looks the type up instead of branching on it
+  const int kMaxType = 16;
+  struct Fills { int n; int groups[2]; };
+  Fills FillsOf(int type)
+  {
+    switch (type) {
+    case 0:  return { 1, { kProton, 0 } };
+    case 1:  return { 2, { kPhonon, kPhononL } };
+    case 2:  return { 2, { kPhonon, kPhononTS } };
+    case 3:  return { 2, { kPhonon, kPhononTF } };
+    default: return { 0, { 0, 0 } };
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------
+// The five histograms of one group, one copy per thread
+struct GroupHists
+{
+  ROOT::TThreadedObject<TH1F> eDep;
+  ROOT::TThreadedObject<TH2F> hitXY;
+  ROOT::TThreadedObject<TH2F> hitYZ;
+  ROOT::TThreadedObject<TH2F> hitXZ;
+  ROOT::TThreadedObject<TH1F> hitTime;
+
+  explicit GroupHists(const std::string& name)
+    : eDep((name+"_eDep").c_str(), "Hit EDeps; eDep [eV]; nEvents",
+           nBinsEDep, eDepMin, eDepMax),
+      hitXY((name+"_hitXY").c_str(), ("XY Locations of "+name+" Hits; X [um]; Y [um]; NHits/bin").c_str(),
+            nBinsX, sensorMinX, sensorMaxX, nBinsY, sensorMinY, sensorMaxY),
+      hitYZ((name+"_hitYZ").c_str(), ("YZ Locations of "+name+" Hits; Y [um]; Z [um]; NHits/bin").c_str(),
+            nBinsY, sensorMinY, sensorMaxY, nBinsZ, sensorMinZ, sensorMaxZ),
+      hitXZ((name+"_hitXZ").c_str(), ("XZ Locations of "+name+" Hits; X [um]; Z [um]; NHits/bin").c_str(),
+            nBinsX, sensorMinX, sensorMaxX, nBinsZ, sensorMinZ, sensorMaxZ),
+      hitTime((name+"_hitTime").c_str(), "Hit Global Time; Time [ns]; nEvents",
+              nBinsTime, minTime, maxTime) {}
+};
+
+// This thread's copies, fetched once per cluster rather than per entry
+struct GroupSlot
+{
+  TH1F* eDep;
+  TH2F* hitXY;
+  TH2F* hitYZ;
+  TH2F* hitXZ;
+  TH1F* hitTime;
+};
+
+// Merged histograms of one group
+struct GroupResult
+{
+  std::shared_ptr<TH1F> eDep;
+  std::shared_ptr<TH2F> hitXY;
+  std::shared_ptr<TH2F> hitYZ;
+  std::shared_ptr<TH2F> hitXZ;
+  std::shared_ptr<TH1F> hitTime;
+};
+
+//---------------------------------------------------------------------------------------
+// What AnalyzeProtonEvent puts in its PDF names: the input name after
+// "sim_output_" (or its stem), without directory or extension
+std::string Tag(const std::string& fileName)
+{
+  const std::string base_filename = "sim_output_";
+  std::string name = fileName.substr(fileName.rfind('/') + 1);
+  name = name.substr(0, name.rfind('.'));
+  std::size_t found = name.find(base_filename);
+  return (found == std::string::npos) ? name : name.substr(found + base_filename.length());
+}
+
+std::string Stem(const std::string& fileName)
+{
+  std::string name = fileName.substr(fileName.rfind('/') + 1);
+  return name.substr(0, name.rfind('.'));
+}
+
+//---------------------------------------------------------------------------------------
+// Fill the histograms of one file, in parallel over its clusters
+bool FillHists(const std::string& fileName, std::array<GroupResult, kNGroups>& results)
+{
+  {
+    std::unique_ptr<TFile> fIn(TFile::Open(fileName.c_str(), "READ"));
+    if (!fIn || fIn->IsZombie() || !fIn->Get<TTree>("Hits")) {
+      std::cerr << fileName << ": no Hits tree, skipped" << std::endl;
+      return false;
+    }
+  }
+
+  std::vector<std::unique_ptr<GroupHists>> hists;
+  for (int group = 0; group < kNGroups; ++group) {
+    hists.emplace_back(new GroupHists(groupNames[group]));
+  }
+
+  std::array<Fills, kMaxType> fillTable;
+  for (int type = 0; type < kMaxType; ++type) fillTable[type] = FillsOf(type);
+
+  ROOT::TTreeProcessorMT processor(fileName, "Hits");
+  processor.Process([&](TTreeReader& reader) {
+    TTreeReaderValue<Double_t> myEnergyDeposit(reader, "EnergyDeposit");
+    TTreeReaderValue<Double_t> myPositionX(reader, "PositionX");
+    TTreeReaderValue<Double_t> myPositionY(reader, "PositionY");
+    TTreeReaderValue<Double_t> myPositionZ(reader, "PositionZ");
+    TTreeReaderValue<Double_t> myTime(reader, "Time");
+    TTreeReaderValue<Int_t> myParticleType(reader, "ParticleType");
+
+    GroupSlot slots[kNGroups];
+    for (int group = 0; group < kNGroups; ++group) {
+      GroupHists& h = *hists[group];
+      slots[group] = { h.eDep.Get().get(), h.hitXY.Get().get(), h.hitYZ.Get().get(),
+                       h.hitXZ.Get().get(), h.hitTime.Get().get() };
+    }
+
+    while (reader.Next()) {
+      int type = *myParticleType;
+      if (type < 0 || type >= kMaxType) continue;
+      const Fills& fills = fillTable[type];
+      for (int i = 0; i < fills.n; ++i) {
+        GroupSlot& slot = slots[fills.groups[i]];
+        slot.eDep->Fill(*myEnergyDeposit);
+        slot.hitXY->Fill(*myPositionX, *myPositionY);
+        slot.hitYZ->Fill(*myPositionY, *myPositionZ);
+        slot.hitXZ->Fill(*myPositionX, *myPositionZ);
+        slot.hitTime->Fill(*myTime);
+      }
+    }
+  });
+
+  for (int group = 0; group < kNGroups; ++group) {
+    GroupHists& h = *hists[group];
+    results[group] = { h.eDep.Merge(), h.hitXY.Merge(), h.hitYZ.Merge(),
+                       h.hitXZ.Merge(), h.hitTime.Merge() };
+    results[group].eDep->SetFillColor(groupColors[group]);
+    results[group].hitTime->SetFillColor(groupColors[group]);
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------------------
+// The eDep overlays of AnalyzeProtonEvent
+void DrawEDeps(const std::vector<int>& groups, const std::vector<std::string>& labels,
+               const std::array<GroupResult, kNGroups>& results, const std::string& pdfName)
+{
+  TCanvas* canvas = new TCanvas();
+  TLegend* legend = new TLegend(0.7,0.7,0.9,0.9);
+  for (std::size_t i = 0; i < groups.size(); ++i) {
+    TH1F* h = results[groups[i]].eDep.get();
+    h->Draw(i == 0 ? "" : "SAME");
+    legend->AddEntry(h, labels[i].c_str(), "f");
+  }
+  canvas->SetLogy();
+  legend->Draw();
+  canvas->SaveAs(pdfName.c_str());
+  canvas->Close();
+  delete legend;
+  delete canvas;
+}
+
+void AnalyzeFile(const std::string& fileName, const std::string& outDir)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  std::array<GroupResult, kNGroups> results;
+  if (!FillHists(fileName, results)) return;
+
+  const std::string tag = Tag(fileName);
+  DrawEDeps({ kProton, kPhonon }, { "Proton eDep per-hit", "All phonon eDep per-hit" },
+            results, outDir + "/proton_phonon_eDeps_" + tag + ".pdf");
+  DrawEDeps({ kPhononL, kPhononTS, kPhononTF },
+            { "PhononL eDep per-hit", "PhononTS eDep per-hit", "PhononTF eDep per-hit" },
+            results, outDir + "/splitPhonon_eDeps_" + tag + ".pdf");
+
+  const std::string analysisFilename = outDir + "/" + Stem(fileName) + "_AnalysisOutput.root";
+  TFile fOut(analysisFilename.c_str(), "RECREATE");
+  for (const GroupResult& result : results) {
+    result.eDep->Write();
+    result.hitXY->Write();
+    result.hitYZ->Write();
+    result.hitXZ->Write();
+    result.hitTime->Write();
+  }
+  fOut.Close();
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  std::cout << fileName << ": " << results[kProton].eDep->GetEntries() << " proton and "
+            << results[kPhonon].eDep->GetEntries() << " phonon hits in " << seconds.count()
+            << " s, histograms in " << analysisFilename << std::endl;
+}
+
+//---------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  unsigned int nThreads = 0;
+  std::string outDir = ".";
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+      nThreads = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+      outDir = argv[++i];
+    } else if (argv[i][0] == '-') {
+      std::cerr << "Usage: " << argv[0] << " [-j threads] [-o outdir] [file.root ...]" << std::endl;
+      return EXIT_FAILURE;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+
+  if (files.empty()) {
+    glob_t found;
+    if (glob("Results/*.root", 0, nullptr, &found) == 0) {
+      for (std::size_t i = 0; i < found.gl_pathc; ++i) files.push_back(found.gl_pathv[i]);
+    }
+    globfree(&found);
+  }
+  if (files.empty()) {
+    std::cerr << "No input files (and none in Results/)" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  gROOT->SetBatch(true);
+  TH1::AddDirectory(false);             // Thread copies must not be owned by files
+  ROOT::EnableImplicitMT(nThreads);
+
+  for (const std::string& file : files) AnalyzeFile(file, outDir);
+
+  return EXIT_SUCCESS;
+}
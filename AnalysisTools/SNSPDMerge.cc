@@ -0,0 +1,327 @@
+//---------------------------------------------------------
+//
+// SNSPDMerge.cc
+//
+// Merges the outputs of jobs run with -shard i/N (or any
+// set of independent jobs) into one output, renumbering the
+// event IDs so they run on globally without gaps:
+//
+//   SNSPDMerge Results/merged Results/sim_shard0 Results/sim_shard1 ...
+//
+// Every argument is an output base name; <base>.hits is
+// merged block by block straight from the memory-mapped
+// inputs, and <base>.root (Hits, Event, Run and, from
+// -digitize jobs, Pulse trees) when built with ROOT.  Each
+// input's event range is the one its job ran, recorded in
+// the header of the binary hits or in the Run tree, so
+// events without hits keep their place.  The event index
+// of the hits and the FirstHit column of the Event tree
+// are shifted to their place in the merged hits.
+//
+//---------------------------------------------------------
+
+//C++ includes
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "HitFileReader.hh"
+
+#ifdef SNSPD_WITH_ROOT
+//ROOT includes
+#include "Compression.h"
+#include "TFile.h"
+#include "TTree.h"
+#endif
+
+using namespace HitFileFormat;
+
+//---------------------------------------------------------------------------------------
+// One input job: where its event IDs start and where they move to
+struct Input
+{
+  std::string base;
+  bool hasRoot = false;
+  bool hasHits = false;
+  long firstEvent = 0;
+  long nEvents = 0;
+  long newFirstEvent = 0;
+  long nHits = 0;               // From the binary hits, else the Hits tree
+  long newFirstHit = 0;
+
+  int Renumber(long id) const { return (int)(newFirstEvent + (id - firstEvent)); }
+};
+
+bool FileExists(const std::string& name)
+{
+  struct stat st;
+  return stat(name.c_str(), &st) == 0;
+}
+
+//---------------------------------------------------------------------------------------
+// Event range and number of hits of one input, from its binary hits
+void FindRangeFromHits(Input& input)
+{
+  HitFileReader reader;
+  if (!reader.Open(input.base + ".hits")) return;
+
+  input.firstEvent = reader.GetFirstEvent();
+  input.nEvents = reader.GetNumEvents();
+  input.nHits = reader.GetNumHits();
+}
+
+//---------------------------------------------------------------------------------------
+// Concatenate the blocks of all binary inputs, rewriting the EventID column,
+// and append the combined event index
+bool MergeHits(const std::vector<Input>& inputs, const std::string& outName)
+{
+  FILE* out = nullptr;
+  std::vector<ColumnInfo> columns;
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+
+  std::vector<char> buffer;
+  std::vector<IndexEntry> eventIndex;
+  for (const Input& input : inputs) {
+    if (!input.hasHits) continue;
+
+    HitFileReader reader;
+    if (!reader.Open(input.base + ".hits")) return false;
+
+    for (IndexEntry entry : reader.GetEventIndex()) {
+      entry.eventID = input.Renumber(entry.eventID);
+      entry.firstHit += header.nHits;
+      entry.block += header.nBlocks;
+      eventIndex.push_back(entry);
+    }
+
+    if (!out) {
+      columns = reader.GetColumns();
+      out = fopen(outName.c_str(), "wb");
+      if (!out) {
+        std::cerr << "Cannot open " << outName << " for writing" << std::endl;
+        return false;
+      }
+      std::memcpy(header.magic, kMagic, sizeof(kMagic));
+      header.version = kVersion;
+      header.byteOrder = kByteOrderMark;
+      header.nColumns = columns.size();
+      for (const Input& other : inputs) header.nEvents += other.nEvents;
+      fwrite(&header, sizeof(header), 1, out);
+      fwrite(columns.data(), sizeof(ColumnInfo), columns.size(), out);
+    } else if (reader.GetColumns().size() != columns.size() ||
+               std::memcmp(reader.GetColumns().data(), columns.data(),
+                           columns.size()*sizeof(ColumnInfo)) != 0) {
+      std::cerr << input.base << ".hits has different columns, not merged" << std::endl;
+      fclose(out);
+      return false;
+    }
+
+    int iEvent = reader.FindColumn("EventID");
+    for (std::size_t b=0; b<reader.GetNumBlocks(); ++b) {
+      HitFileReader::Block block = reader.GetBlock(b);
+      std::uint32_t n = block.size();
+
+      std::size_t payload = 0;
+      for (const ColumnInfo& column : columns) payload += Padded(n * ElementSize(column.type));
+
+      BlockHeader blockHeader = { kBlockMagic, n, sizeof(BlockHeader) + payload };
+      fwrite(&blockHeader, sizeof(blockHeader), 1, out);
+
+      for (std::size_t c=0; c<columns.size(); ++c) {
+        std::size_t bytes = Padded(n * ElementSize(columns[c].type));
+        const char* data = block.Column<char>(c);
+        if ((int)c == iEvent) {
+          buffer.assign(data, data + bytes);
+          int* eventID = reinterpret_cast<int*>(buffer.data());
+          for (std::uint32_t i=0; i<n; ++i) eventID[i] = input.Renumber(eventID[i]);
+          data = buffer.data();
+        }
+        fwrite(data, bytes, 1, out);
+      }
+
+      header.nBlocks++;
+      header.nHits += n;
+    }
+  }
+
+  if (!out) return true;          // No binary inputs
+
+  IndexHeader indexHeader = { kIndexMagic, 0, eventIndex.size() };
+  fwrite(&indexHeader, sizeof(indexHeader), 1, out);
+  fwrite(eventIndex.data(), sizeof(IndexEntry), eventIndex.size(), out);
+
+  fseek(out, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, out);
+  fclose(out);
+  std::cout << "Wrote " << header.nHits << " hits of " << eventIndex.size()
+            << " events in " << header.nBlocks << " blocks to " << outName << std::endl;
+  return true;
+}
+
+#ifdef SNSPD_WITH_ROOT
+//---------------------------------------------------------------------------------------
+// Event range of one input from its Run tree, spanning all its runs
+void FindRangeFromRoot(Input& input)
+{
+  TFile* fIn = TFile::Open((input.base + ".root").c_str(), "READ");
+  if (!fIn || fIn->IsZombie()) return;
+
+  TTree* runs = fIn->Get<TTree>("Run");
+  if (runs && runs->GetBranch("NEvents")) {
+    int firstEvent = 0;
+    int nEvents = 0;
+    runs->SetBranchAddress("FirstEvent", &firstEvent);
+    runs->SetBranchAddress("NEvents", &nEvents);
+    long first = std::numeric_limits<long>::max();
+    long end = std::numeric_limits<long>::min();
+    for (Long64_t i=0; i<runs->GetEntries(); ++i) {
+      runs->GetEntry(i);
+      if (nEvents <= 0) continue;
+      first = std::min<long>(first, firstEvent);
+      end = std::max<long>(end, (long)firstEvent + nEvents);
+    }
+    if (end > first) {
+      input.firstEvent = first;
+      input.nEvents = end - first;
+    }
+  }
+
+  TTree* hits = fIn->Get<TTree>("Hits");
+  if (hits && !input.hasHits) input.nHits = hits->GetEntries();
+  delete fIn;
+}
+
+// Copy one tree from every input, renumbering the event ID branch and
+// shifting the hit offset branch, if any (-1, unknown, stays).  The output
+// tree reads straight from the input buffers (CopyAddresses), so only
+// those columns are touched per entry.
+void MergeTree(const std::vector<Input>& inputs, TFile* fOut,
+               const char* treeName, const char* idBranch,
+               const char* hitBranch = nullptr)
+{
+  TTree* out = nullptr;
+  for (const Input& input : inputs) {
+    if (!input.hasRoot) continue;
+
+    TFile* fIn = TFile::Open((input.base + ".root").c_str(), "READ");
+    if (!fIn || fIn->IsZombie()) continue;
+    TTree* in = fIn->Get<TTree>(treeName);
+    if (!in) { delete fIn; continue; }
+
+    int id = 0;
+    double firstHit = 0.;
+    in->SetBranchAddress(idBranch, &id);
+    bool shiftHits = hitBranch && in->GetBranch(hitBranch);
+    if (shiftHits) in->SetBranchAddress(hitBranch, &firstHit);
+    if (!out) {
+      fOut->cd();
+      out = in->CloneTree(0);
+      out->SetAutoFlush(-32*1024*1024);      // ~32 MB clusters
+    } else {
+      in->CopyAddresses(out);
+    }
+
+    for (Long64_t i=0; i<in->GetEntries(); ++i) {
+      in->GetEntry(i);
+      id = input.Renumber(id);
+      if (shiftHits && firstHit >= 0.) firstHit += input.newFirstHit;
+      out->Fill();
+    }
+
+    in->CopyAddresses(out, true);              // Detach before closing
+    delete fIn;
+  }
+
+  if (out) {
+    fOut->cd();
+    out->Write();
+    std::cout << "Wrote " << out->GetEntries() << " " << treeName << " entries" << std::endl;
+  }
+}
+
+bool MergeRoot(const std::vector<Input>& inputs, const std::string& outName)
+{
+  bool any = false;
+  for (const Input& input : inputs) any = any || input.hasRoot;
+  if (!any) return true;
+
+  // LZ4 keeps compression from dominating the merge time
+  TFile* fOut = TFile::Open(outName.c_str(), "RECREATE", "",
+                            ROOT::CompressionSettings(ROOT::kLZ4, 1));
+  if (!fOut || fOut->IsZombie()) {
+    std::cerr << "Cannot open " << outName << " for writing" << std::endl;
+    return false;
+  }
+
+  MergeTree(inputs, fOut, "Hits", "EventID");
+  MergeTree(inputs, fOut, "Event", "Event", "FirstHit");
+  MergeTree(inputs, fOut, "Run", "FirstEvent");
+  MergeTree(inputs, fOut, "Pulse", "EventID");
+  MergeTree(inputs, fOut, "PulseStrips", "EventID");
+
+  fOut->Close();
+  delete fOut;
+  return true;
+}
+#endif
+
+//---------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <output base> <input base> [<input base> ...]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string outBase = argv[1];
+  std::vector<Input> inputs;
+  for (int i=2; i<argc; ++i) {
+    Input input;
+    input.base = argv[i];
+#ifdef SNSPD_WITH_ROOT
+    input.hasRoot = FileExists(input.base + ".root");
+#endif
+    input.hasHits = FileExists(input.base + ".hits");
+    if (!input.hasRoot && !input.hasHits) {
+      std::cerr << "No output found for " << input.base << ", skipped" << std::endl;
+      continue;
+    }
+    inputs.push_back(input);
+  }
+
+  // Inputs follow each other in the order given, without gaps
+  long nextEvent = 0;
+  long nextHit = 0;
+  for (Input& input : inputs) {
+    if (input.hasHits) FindRangeFromHits(input);
+#ifdef SNSPD_WITH_ROOT
+    if (input.nEvents == 0 && input.hasRoot) FindRangeFromRoot(input);
+#endif
+    input.newFirstHit = nextHit;
+    nextHit += input.nHits;
+    input.newFirstEvent = nextEvent;
+    if (input.nEvents == 0) {                   // No events at all
+      std::cout << input.base << ": no events" << std::endl;
+      continue;
+    }
+
+    nextEvent += input.nEvents;
+    std::cout << input.base << ": events " << input.firstEvent << "-"
+              << input.firstEvent + input.nEvents - 1
+              << " -> " << input.newFirstEvent << "-" << nextEvent - 1 << std::endl;
+  }
+
+  if (!MergeHits(inputs, outBase + ".hits")) return EXIT_FAILURE;
+#ifdef SNSPD_WITH_ROOT
+  if (!MergeRoot(inputs, outBase + ".root")) return EXIT_FAILURE;
+#endif
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  MeanderNavigationBench.cc
+//
+// Description:	Times the navigation queries of MeanderSolid against the
+//		equivalent G4MultiUnion on the same random points and
+//		directions, and counts the queries where they disagree.
+//
+// Usage:	MeanderNavigationBench [nPoints] [seed]
+
+#include "MeanderSolid.hh"
+#include "G4MultiUnion.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "Randomize.hh"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+
+namespace {
+  // Points cluster near the film, where the navigator actually asks
+  std::vector<G4ThreeVector> SamplePoints(const G4VSolid& solid, size_t n) {
+    G4ThreeVector pMin, pMax;
+    solid.BoundingLimits(pMin, pMax);
+    const G4double zMid = (pMin.z() + pMax.z())/2;
+    const G4double dz = pMax.z() - pMin.z();
+
+    std::vector<G4ThreeVector> points;
+    points.reserve(n);
+    for (size_t i=0; i<n; ++i) {
+      if (i%4 == 0) {
+	points.push_back(solid.GetPointOnSurface());
+	continue;
+      }
+      points.emplace_back(pMin.x() + (pMax.x()-pMin.x())*G4UniformRand(),
+			  pMin.y() + (pMax.y()-pMin.y())*G4UniformRand(),
+			  zMid + 10.*dz*(2.*G4UniformRand() - 1.));
+    }
+    return points;
+  }
+
+  std::vector<G4ThreeVector> SampleDirections(size_t n) {
+    std::vector<G4ThreeVector> directions;
+    directions.reserve(n);
+    for (size_t i=0; i<n; ++i) {
+      G4double cosTheta = 2.*G4UniformRand() - 1.;
+      G4double phi = twopi*G4UniformRand();
+      G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+      directions.emplace_back(sinTheta*std::cos(phi), sinTheta*std::sin(phi),
+			      cosTheta);
+    }
+    return directions;
+  }
+
+  // Wall time of one pass over all points, in ns per call
+  G4double Time(size_t n, const std::function<G4double(size_t)>& query,
+		G4double& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i=0; i<n; ++i) checksum += query(i);
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<G4double, std::nano>(stop - start).count() / n;
+  }
+
+  G4bool Differ(G4double a, G4double b) {
+    if (a == b) return false;			// Including both kInfinity
+    return std::abs(a - b) > 1e-9*mm + 1e-9*std::abs(b);
+  }
+}
+
+
+int main(int argc, char** argv) {
+  size_t nPoints = (argc > 1) ? std::strtoul(argv[1], 0, 10) : 100000;
+  long seed = (argc > 2) ? std::atol(argv[2]) : 12345;
+  G4Random::setTheSeed(seed);
+
+  MeanderSolid meander("bench_meander", MeanderLayout::FromDetectorParameters());
+  G4MultiUnion* multiUnion = meander.BuildMultiUnion("bench_union");
+
+  std::vector<G4ThreeVector> points = SamplePoints(meander, nPoints);
+  std::vector<G4ThreeVector> directions = SampleDirections(nPoints);
+
+  // Ray queries need points on the right side of the surface
+  std::vector<size_t> outside, inside;
+  for (size_t i=0; i<nPoints; ++i) {
+    EInside location = multiUnion->Inside(points[i]);
+    if (location == kOutside) outside.push_back(i);
+    else if (location == kInside) inside.push_back(i);
+  }
+
+  std::printf("MeanderSolid vs G4MultiUnion: %d strips, %zu points"
+	      " (%zu outside, %zu inside)\n", meander.GetLayout().nStrips,
+	      nPoints, outside.size(), inside.size());
+  std::printf("%-24s %14s %14s %9s %10s\n", "query", "union ns/call",
+	      "meander ns/call", "speedup", "mismatches");
+
+  G4double checksum = 0.;
+  auto report = [&](const char* query, const std::vector<size_t>& sample,
+		    const std::function<G4double(const G4VSolid&, size_t)>& call,
+		    G4bool compare) {
+    if (sample.empty()) return;
+    G4double tUnion = Time(sample.size(), [&](size_t k) {
+	return call(*multiUnion, sample[k]); }, checksum);
+    G4double tMeander = Time(sample.size(), [&](size_t k) {
+	return call(meander, sample[k]); }, checksum);
+
+    std::printf("%-24s %14.1f %14.1f %8.1fx ", query, tUnion, tMeander,
+		tUnion/tMeander);
+    if (!compare) {
+      std::printf("%10s\n", "-");
+      return;
+    }
+
+    size_t mismatches = 0;
+    for (size_t i : sample) {
+      if (Differ(call(meander, i), call(*multiUnion, i))) ++mismatches;
+    }
+    std::printf("%10zu\n", mismatches);
+  };
+
+  std::vector<size_t> all(nPoints);
+  for (size_t i=0; i<nPoints; ++i) all[i] = i;
+
+  report("Inside", all, [&](const G4VSolid& s, size_t i) {
+      return G4double(s.Inside(points[i])); }, true);
+  report("DistanceToIn(p,v)", outside, [&](const G4VSolid& s, size_t i) {
+      return s.DistanceToIn(points[i], directions[i]); }, true);
+  report("DistanceToOut(p,v)", inside, [&](const G4VSolid& s, size_t i) {
+      return s.DistanceToOut(points[i], directions[i]); }, true);
+
+  // Safeties are only lower bounds, so they are timed but not compared
+  report("DistanceToIn(p)", outside, [&](const G4VSolid& s, size_t i) {
+      return s.DistanceToIn(points[i]); }, false);
+  report("DistanceToOut(p)", inside, [&](const G4VSolid& s, size_t i) {
+      return s.DistanceToOut(points[i]); }, false);
+
+  std::printf("(checksum %g)\n", checksum);
+
+  delete multiUnion;
+  return 0;
+}
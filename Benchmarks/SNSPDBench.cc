@@ -0,0 +1,372 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  SNSPDBench.cc
+//
+// Description:	End-to-end benchmark of the simulation.  Runs fixed-seed,
+//		headless versions of the throwProton, throwMuon and
+//		pceStudy macros, each in its own process (so peak RSS and
+//		initialization time are its own), and reports events/s,
+//		steps/s, hits/s, peak RSS and initialization time as JSON.
+//		Simulation output goes to Results/bench_<scenario>.root and
+//		its log to Results/bench_<scenario>.log.
+//
+//		With -startup every scenario runs twice with a physics-table
+//		cache (see PhysicsCache.hh) in Results/bench_physics_cache,
+//		emptied before each scenario: cold builds and stores the
+//		tables, warm retrieves them.  Both count the tables in
+//		initSeconds, and "startup" lists the two side by side.
+//
+// Usage:	SNSPDBench [-scenarios name,...] [-events N] [-nThreads T]
+//			   [-startup] [-o results.json]
+//		SNSPDBench -run name -result file.json [-events N] [-nThreads T]
+//			   [-physicsCache dir]
+//
+//		The second form runs one scenario in the current process and
+//		is what the first form executes for each scenario.
+
+#include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4UImanager.hh"
+#include "G4Version.hh"
+
+#include "G4CMPConfigManager.hh"
+#include "ActionInitialization.hh"
+#include "ConfigManager.hh"
+#include "DetectorConstruction.hh"
+#include "G4Args.hh"
+#include "PhysicsCache.hh"
+#include "PhysicsList.hh"
+#include "Run.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+  const long kBenchSeed = 20240521;
+  const char* const kPhysicsCache = "Results/bench_physics_cache";
+
+  // The macros in G4Macros, without visualization, as command line
+  // arguments plus the G4CMP commands they set
+  struct Scenario {
+    const char* name;
+    int defaultEvents;
+    std::vector<std::string> args;
+    std::vector<std::string> commands;
+  };
+
+  const std::vector<Scenario>& Scenarios() {
+    static const std::vector<Scenario> scenarios = {
+      { "throwProton", 5,
+	{ "-particleName", "proton", "-particleMom", "120000",
+	  "-particlePos", "insideCryostat" },
+	{ "/g4cmp/producePhonons 0.1", "/g4cmp/sampleLuke 0.1",
+	  "/g4cmp/produceCharges 0.001" } },
+      { "throwMuon", 5,
+	{ "-particleName", "mu-", "-particleMom", "4000",
+	  "-particlePos", "0,-0.5,-0.5252415", "-particleMomDir", "0,0.5,1" },
+	{ "/g4cmp/producePhonons 0.01", "/g4cmp/sampleLuke 0.01",
+	  "/g4cmp/produceCharges 0.0001" } },
+      // A 4 meV phononL in the substrate; the gun cannot sample the chip
+      // volume like the macro's GPS, so -rndgun places it
+      { "pceStudy", 1000,
+	{ "-particleName", "phononL", "-particleMom", "4e-9", "-rndgun" },
+	{ "/g4cmp/phononBounces 1000" } },
+    };
+    return scenarios;
+  }
+
+  const Scenario* FindScenario(const std::string& name) {
+    for (const Scenario& scenario : Scenarios()) {
+      if (name == scenario.name) return &scenario;
+    }
+    return nullptr;
+  }
+
+  void Usage() {
+    std::cerr << "Usage: SNSPDBench [-scenarios name,...] [-events N]"
+	      << " [-nThreads T] [-startup] [-o results.json]\n       scenarios:";
+    for (const Scenario& scenario : Scenarios()) std::cerr << " " << scenario.name;
+    std::cerr << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  double Seconds(std::chrono::steady_clock::time_point start,
+		 std::chrono::steady_clock::time_point stop) {
+    return std::chrono::duration<double>(stop - start).count();
+  }
+
+
+  // Run one scenario in this process and write its JSON object to result
+
+  int RunScenario(const Scenario& scenario, int nEvents, int nThreads,
+		  const std::string& physicsCache, const std::string& result) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::string> argStrings = { "SNSPDBench",
+      "-o", std::string("bench_") + scenario.name,
+      "-runevt", std::to_string(nEvents),
+      "-seed", std::to_string(kBenchSeed) };
+    if (nThreads > 0) {
+      argStrings.insert(argStrings.end(),
+			{ "-nThreads", std::to_string(nThreads) });
+    }
+    argStrings.insert(argStrings.end(), scenario.args.begin(), scenario.args.end());
+
+    std::vector<char*> argv;
+    for (std::string& arg : argStrings) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    // Same setup as SNSPDHighEnergy, without visualization or UI session
+    MyG4Args* args = new MyG4Args(static_cast<int>(argStrings.size()), argv.data());
+
+    G4RunManagerType runManagerType = G4RunManagerType::SerialOnly;
+    if (args->GetRunManagerType() == "mt") {
+      runManagerType = G4RunManagerType::MTOnly;
+    } else if (args->GetRunManagerType() == "tasking") {
+      runManagerType = G4RunManagerType::TaskingOnly;
+    }
+    G4RunManager* runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+    if (args->GetNThreads() > 0) runManager->SetNumberOfThreads(args->GetNThreads());
+
+    G4CMPConfigManager::Instance();
+    ConfigManager::Instance();
+
+    G4VModularPhysicsList* physics = CreatePhysicsList();
+    runManager->SetUserInitialization(new DetectorConstruction(args));
+    runManager->SetUserInitialization(physics);
+    runManager->SetUserInitialization(new ActionInitialization(args));
+    runManager->Initialize();
+
+    G4UImanager* UImanager = G4UImanager::GetUIpointer();
+    for (const std::string& command : scenario.commands) {
+      UImanager->ApplyCommand(command);
+    }
+
+    // Without a cache the tables are built by the first BeamOn, and so
+    // counted in runSeconds
+    const char* cacheState = "none";
+    if (!physicsCache.empty()) {
+      cacheState = PhysicsCache::Prepare(physics, physicsCache) ? "warm" : "cold";
+    }
+
+    auto initTime = std::chrono::steady_clock::now();
+    runManager->BeamOn(args->GetEventsToRun());
+    auto endTime = std::chrono::steady_clock::now();
+
+    // The last run stays current until the next BeamOn
+    const Run* run = static_cast<const Run*>(runManager->GetCurrentRun());
+    G4long nSteps = run ? run->GetNumberOfSteps() : 0;
+    G4long nHits = run ? run->GetNumberOfHits() : 0;
+    G4int nDone = run ? run->GetNumberOfEvent() : 0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);		// ru_maxrss is in kB on Linux
+
+    double initSeconds = Seconds(startTime, initTime);
+    double runSeconds = Seconds(initTime, endTime);
+    auto rate = [runSeconds](double count) {
+      return runSeconds > 0. ? count / runSeconds : 0.;
+    };
+
+    std::ofstream out(result);
+    out << "{\"scenario\": \"" << scenario.name << "\""
+	<< ", \"events\": " << nDone
+	<< ", \"threads\": " << args->GetNThreads()
+	<< ", \"seed\": " << kBenchSeed
+	<< ", \"physicsCache\": \"" << cacheState << "\""
+	<< ", \"initSeconds\": " << initSeconds
+	<< ", \"runSeconds\": " << runSeconds
+	<< ", \"eventsPerSecond\": " << rate(nDone)
+	<< ", \"steps\": " << nSteps
+	<< ", \"stepsPerSecond\": " << rate(nSteps)
+	<< ", \"hits\": " << nHits
+	<< ", \"hitsPerSecond\": " << rate(nHits)
+	<< ", \"peakRSSMB\": " << usage.ru_maxrss / 1024. << "}";
+    out.close();
+
+    delete runManager;
+    delete args;
+    return out ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+
+  // Re-execute this program for one scenario with its output sent to a log,
+  // and return the JSON object it wrote (or one describing the failure)
+
+  std::string RunChild(const char* self, const Scenario& scenario, int nEvents,
+		       int nThreads, const std::string& startup = "") {
+    std::string base = std::string("Results/bench_") + scenario.name;
+    if (!startup.empty()) base += "_" + startup;
+    const std::string result = base + ".json";
+    const std::string log = base + ".log";
+    std::remove(result.c_str());
+
+    std::vector<std::string> argStrings = { self, "-run", scenario.name,
+      "-result", result, "-events", std::to_string(nEvents),
+      "-nThreads", std::to_string(nThreads) };
+    if (!startup.empty()) {
+      argStrings.insert(argStrings.end(), { "-physicsCache", kPhysicsCache });
+    }
+    std::vector<char*> argv;
+    for (std::string& arg : argStrings) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    std::cerr << "SNSPDBench: running " << scenario.name << " (" << nEvents
+	      << " events" << (startup.empty() ? "" : ", " + startup + " start")
+	      << "), log in " << log << std::endl;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+      int fd = open(log.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+      if (fd >= 0) {
+	dup2(fd, STDOUT_FILENO);
+	dup2(fd, STDERR_FILENO);
+	close(fd);
+      }
+      execvp(self, argv.data());
+      _exit(127);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+	!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::ostringstream error;
+      error << "{\"scenario\": \"" << scenario.name << "\", \"error\": \"";
+      if (pid < 0) error << "fork failed";
+      else if (WIFSIGNALED(status)) error << "killed by signal " << WTERMSIG(status);
+      else error << "exit status " << WEXITSTATUS(status);
+      error << ", see " << log << "\"}";
+      return error.str();
+    }
+
+    std::ifstream in(result);
+    std::stringstream json;
+    json << in.rdbuf();
+    return json.str();
+  }
+
+
+  // Empty the physics-table cache: a directory of tables per configuration
+
+  void ClearPhysicsCache() {
+    DIR* tables = opendir(kPhysicsCache);
+    if (!tables) return;
+    while (const dirent* entry = readdir(tables)) {
+      const std::string name = entry->d_name;
+      if (name == "." || name == "..") continue;
+      const std::string dir = std::string(kPhysicsCache) + "/" + name;
+      if (DIR* files = opendir(dir.c_str())) {
+	while (const dirent* file = readdir(files)) {
+	  unlink((dir + "/" + file->d_name).c_str());
+	}
+	closedir(files);
+      }
+      rmdir(dir.c_str());
+    }
+    closedir(tables);
+  }
+
+  // initSeconds of a scenario's JSON object, -1 if it failed
+  double InitSeconds(const std::string& json) {
+    const std::string field = "\"initSeconds\": ";
+    const std::size_t at = json.find(field);
+    return at == std::string::npos ? -1. : std::atof(json.c_str() + at + field.size());
+  }
+}
+
+
+int main(int argc, char** argv) {
+  std::string runName, result, output;
+  std::vector<std::string> names;
+  int nEvents = 0, nThreads = 0;
+  std::string physicsCache;
+  bool startup = false;
+
+  for (int i=1; i<argc; ++i) {
+    if (std::strcmp(argv[i], "-startup") == 0) {
+      startup = true;
+      continue;
+    }
+    if (i+1 >= argc) Usage();
+    if (std::strcmp(argv[i], "-run") == 0) runName = argv[++i];
+    else if (std::strcmp(argv[i], "-result") == 0) result = argv[++i];
+    else if (std::strcmp(argv[i], "-events") == 0) nEvents = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "-nThreads") == 0) nThreads = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "-o") == 0) output = argv[++i];
+    else if (std::strcmp(argv[i], "-physicsCache") == 0) physicsCache = argv[++i];
+    else if (std::strcmp(argv[i], "-scenarios") == 0) {
+      std::istringstream list(argv[++i]);
+      std::string name;
+      while (std::getline(list, name, ',')) names.push_back(name);
+    } else Usage();
+  }
+
+  // One scenario in this process
+  if (!runName.empty()) {
+    const Scenario* scenario = FindScenario(runName);
+    if (!scenario || result.empty()) Usage();
+    return RunScenario(*scenario, nEvents > 0 ? nEvents : scenario->defaultEvents,
+		       nThreads, physicsCache, result);
+  }
+
+  if (names.empty()) {
+    for (const Scenario& scenario : Scenarios()) names.push_back(scenario.name);
+  }
+
+  struct stat st;
+  if (stat("Results", &st) == -1) mkdir("Results", 0700);
+
+  std::ostringstream json, startupJson;
+  json << "{\"benchmark\": \"SNSPDBench\", \"geant4\": " << G4VERSION_NUMBER
+       << ", \"scenarios\": [";
+  for (std::size_t i=0; i<names.size(); ++i) {
+    const Scenario* scenario = FindScenario(names[i]);
+    if (!scenario) Usage();
+    const int events = nEvents > 0 ? nEvents : scenario->defaultEvents;
+    json << (i > 0 ? ",\n  " : "\n  ");
+    if (!startup) {
+      json << RunChild(argv[0], *scenario, events, nThreads);
+      continue;
+    }
+
+    // Every scenario starts cold, whatever the previous one stored
+    ClearPhysicsCache();
+    const std::string cold = RunChild(argv[0], *scenario, events, nThreads, "cold");
+    const std::string warm = RunChild(argv[0], *scenario, events, nThreads, "warm");
+    json << cold << ",\n  " << warm;
+    startupJson << (i > 0 ? ",\n  " : "\n  ")
+		<< "{\"scenario\": \"" << scenario->name << "\""
+		<< ", \"coldInitSeconds\": " << InitSeconds(cold)
+		<< ", \"warmInitSeconds\": " << InitSeconds(warm) << "}";
+  }
+  json << "\n]";
+  if (startup) json << ",\n\"startup\": [" << startupJson.str() << "\n]";
+  json << "}\n";
+
+  if (output.empty()) {
+    std::cout << json.str();
+  } else {
+    std::ofstream(output) << json.str();
+    std::cerr << "SNSPDBench: results in " << output << std::endl;
+  }
+
+  return 0;
+}
@@ -16,23 +16,18 @@
 // 20240521  Renamed for tutorial use
 
 #include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
 #include "G4UIExecutive.hh"
 #include "G4UImanager.hh"
 #include "G4VisExecutive.hh"
 
-#include "G4CMPPhysicsList.hh"
-#include "G4CMPPhysics.hh"
 #include "G4CMPConfigManager.hh"
 #include "ActionInitialization.hh"
 #include "ConfigManager.hh"
 #include "DetectorConstruction.hh"
 #include "DetectorParameters.hh"
-
-#include "FTFP_BERT.hh"
-#include "G4OpticalPhysics.hh" // Optical physics
-#include "G4RadioactiveDecayPhysics.hh" // Radioactive decay physics
-#include "G4StepLimiterPhysics.hh" // Step limiter physics
-#include "G4EmLivermorePhysics.hh"
+#include "PhysicsCache.hh"
+#include "PhysicsList.hh"
 
 #include "G4Args.hh"
 
@@ -42,33 +37,35 @@ using namespace DetectorParameters;
 int main(int argc, char** argv)
 {
   MyG4Args* myG4Args = new MyG4Args(argc, argv);
- // Construct the run manager
+ // Construct the run manager (sequential unless -runManager/-nThreads ask otherwise)
  //
- G4RunManager* runManager = new G4RunManager;
+ G4RunManagerType runManagerType = G4RunManagerType::SerialOnly;
+ if (myG4Args->GetRunManagerType() == "mt") {
+  runManagerType = G4RunManagerType::MTOnly;
+ } else if (myG4Args->GetRunManagerType() == "tasking") {
+  runManagerType = G4RunManagerType::TaskingOnly;
+ }
+ G4RunManager* runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+ if (myG4Args->GetNThreads() > 0) {
+  runManager->SetNumberOfThreads(myG4Args->GetNThreads());
+ }
 
  // Create configuration managers to ensure macro commands exist
  G4CMPConfigManager::Instance();
  ConfigManager::Instance();
+ if (myG4Args->GetStepLimits() != "") {
+  ConfigManager::SetStepLimits(myG4Args->GetStepLimits());
+ }
 
  // Set mandatory initialization classes
  //
  DetectorConstruction* detector = new DetectorConstruction(myG4Args);
  runManager->SetUserInitialization(detector);
 
- G4cout<< " ### Starting Define Physics" <<G4endl;
- FTFP_BERT* physics = new FTFP_BERT(0);
- physics->RegisterPhysics(new G4CMPPhysics);
-
-//  physics->RegisterPhysics(new G4RadioactiveDecayPhysics); // For radioactive decay
- physics->RegisterPhysics(new G4OpticalPhysics);
- physics->RegisterPhysics(new G4EmLivermorePhysics); // For low energy photons
- G4StepLimiterPhysics* stepLimitPhys = new G4StepLimiterPhysics();
-//  stepLimitPhys->SetApplyToAll(true); // activates step limit for ALL particles
- physics->RegisterPhysics(stepLimitPhys);
-
- physics->SetCuts();
- G4cout<< " ### Finish Define Physics" <<G4endl;  
-
+ // Physics list shared with SNSPDBench (see PhysicsList.hh); a deposit
+ // replay only needs G4CMP
+ G4VModularPhysicsList* physics = myG4Args->IsDepositReplay() ?
+  CreatePhononPhysicsList() : CreatePhysicsList();
  runManager->SetUserInitialization(physics);
  
  // Set user action classes (different for Geant4 10.0)
@@ -85,6 +82,12 @@ int main(int argc, char** argv)
  // Initialize the runManager
  runManager->Initialize();
 
+ // With -physicsCache the tables are built (or retrieved) here, before
+ // the first run
+ if (myG4Args->GetPhysicsCache() != "") {
+  PhysicsCache::Prepare(physics, myG4Args->GetPhysicsCache());
+ }
+
  if (argc==1 || (myG4Args->GetRunevt() == 0))   // interactive mode
  {
 
@@ -103,7 +106,7 @@ int main(int argc, char** argv)
  {
 
   // Run the specified number of events
-  G4int numberOfEvents = myG4Args->GetRunevt();
+  G4int numberOfEvents = myG4Args->GetEventsToRun();
   G4cout << "### Running " << numberOfEvents << " events." << G4endl;
   runManager->BeamOn(numberOfEvents);
 
@@ -10,6 +10,7 @@ public:
   ActionInitialization(MyG4Args* MainArgs);
   virtual ~ActionInitialization();
   virtual void Build() const;
+  virtual void BuildForMaster() const;
 
 private:
   MyG4Args* PassArgs;
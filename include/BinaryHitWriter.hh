@@ -0,0 +1,55 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef BinaryHitWriter_hh
+#define BinaryHitWriter_hh 1
+
+// $Id$
+// File:  BinaryHitWriter.hh
+//
+// Description:	Singleton writer for the columnar binary hit file (see
+//		HitFileFormat.hh), selected with -outputFormat binary|both.
+//		The master opens and closes the file; any thread may append
+//		a block of hits, one whole flush at a time.  The event index
+//		is collected as blocks are appended and written on close.
+
+#include "HitFileFormat.hh"
+#include "HitColumns.hh"
+#include "G4Threading.hh"
+#include "globals.hh"
+#include <cstdio>
+#include <vector>
+
+
+class BinaryHitWriter {
+public:
+  ~BinaryHitWriter();
+  static BinaryHitWriter* Instance();
+
+  // The job runs event IDs firstEvent to firstEvent + nEvents - 1
+  void Open(const G4String& fileName, G4int firstEvent, G4int nEvents);
+  void Close();
+  G4bool IsOpen() const { return file != 0; }
+
+  // Append the hits as one block; safe to call from worker threads.
+  // Returns the position of the block's first hit in the file.
+  std::uint64_t WriteBlock(const HitColumns& hits);
+
+private:
+  BinaryHitWriter();		// Singleton: only constructed on request
+  BinaryHitWriter(const BinaryHitWriter&) = delete;
+  BinaryHitWriter& operator=(const BinaryHitWriter&) = delete;
+
+  static BinaryHitWriter* theInstance;
+
+  std::FILE* file;
+  G4String fileName;
+  G4Mutex fileMutex;
+  std::uint64_t nBlocks;
+  std::uint64_t nHits;
+  std::vector<HitFileFormat::IndexEntry> eventIndex;
+};
+
+#endif	/* BinaryHitWriter_hh */
@@ -12,11 +12,18 @@
 // Description:	Singleton container class for user configuration of G4CMP
 //		phonon example. Looks for environment variables	at
 //		initialization to set default values; active values may be
-//		changed via macro commands (see ConfigMessenger).
+//		changed via macro commands (see ConfigMessenger).  The
+//		meander dimensions and the absorption and reflection
+//		probabilities of the border surfaces may be changed too,
+//		and RunScan() runs a list of such configurations in one
+//		job, each into its own output.
 //
 // 20170816  M. Kelsey -- Extract hit filename from G4CMPConfigManager.
 
 #include "globals.hh"
+#include "MeanderSolid.hh"
+#include <map>
+#include <utility>
 
 class ConfigMessenger;
 
@@ -29,6 +36,17 @@ public:
   // Access current values
   static const G4String& GetHitOutput()  { return Instance()->Hit_file; }
   static const G4String& GetPrimaryOutput()  { return Instance()->Primary_file; }
+  static const G4String& GetStepLimits() { return Instance()->StepLimits_spec; }
+  static const MeanderLayout& GetMeanderLayout() { return Instance()->Meander_layout; }
+  static const G4String& GetOutputTag() { return Instance()->Output_tag; }
+
+  // Absorption and reflection probabilities by border surface name (see
+  // DetectorConstruction); surfaces not listed keep their own values
+  using SurfaceProbabilities = std::map<G4String, std::pair<G4double,G4double> >;
+  static const SurfaceProbabilities& GetPhononSurfaces()
+    { return Instance()->PhononSurface_probs; }
+  static const SurfaceProbabilities& GetChargeSurfaces()
+    { return Instance()->ChargeSurface_probs; }
 
   // Change values (e.g., via Messenger)
   static void SetHitOutput(const G4String& name)
@@ -38,6 +56,31 @@ public:
   static void SetPrimaryOutput(const G4String& name)
     { Instance()->Hit_file=name; UpdateGeometry(); }
 
+  // Step limits by volume and particle class (see StepLimits.hh)
+  static void SetStepLimits(const G4String& spec)
+    { Instance()->StepLimits_spec=spec; UpdateGeometry(); }
+
+  // Meander dimensions (see MeanderSolid.hh)
+  static void SetMeanderLayout(const MeanderLayout& layout)
+    { Instance()->Meander_layout=layout; UpdateGeometry(); }
+
+  // Border surface probabilities, "name absProb reflProb"
+  static void SetPhononSurface(const G4String& spec)
+    { SetSurface(Instance()->PhononSurface_probs, spec); }
+  static void SetChargeSurface(const G4String& spec)
+    { SetSurface(Instance()->ChargeSurface_probs, spec); }
+
+  // Appended to the output file names, "" for none
+  static void SetOutputTag(const G4String& tag) { Instance()->Output_tag=tag; }
+
+  // Back to the built-in meander and surfaces
+  static void ResetParameters();
+
+  // Run nEvents for every configuration listed in the file, one per
+  // line: an output tag, then macro commands separated by ';'.  Each
+  // configuration starts from the built-in parameters.
+  static void RunScan(const G4String& fileName, G4int nEvents);
+
   
   static void UpdateGeometry();
 
@@ -50,9 +93,16 @@ private:
 
   static ConfigManager* theInstance;
 
+  static void SetSurface(SurfaceProbabilities& table, const G4String& spec);
+
 private:
   G4String Hit_file;	// Output file of e/h hits ($G4CMP_HIT_FILE)
   G4String Primary_file;	// Output file of primaries
+  G4String StepLimits_spec;	// Step limits ($G4CMP_STEP_LIMITS)
+  MeanderLayout Meander_layout;	// DetectorParameters unless changed
+  SurfaceProbabilities PhononSurface_probs;	// Changed surfaces only
+  SurfaceProbabilities ChargeSurface_probs;
+  G4String Output_tag;		// Of the scan configuration being run
 
   ConfigMessenger* messenger;
 };
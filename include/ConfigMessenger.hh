@@ -10,7 +10,9 @@
 // File:  ConfigMessenger.hh
 //
 // Description:	Macro command defitions to set user configuration in
-//		ConfigManager.
+//		ConfigManager.  Meander dimensions and surface probabilities
+//		rebuild the geometry before the next run; /g4cmp/scan runs
+//		a list of configurations of them.
 //
 // 20170816  Michael Kelsey
 
@@ -18,6 +20,9 @@
 
 class ConfigManager;
 class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithoutParameter;
 class G4UIcommand;
 
 
@@ -31,6 +36,17 @@ public:
 private:
   ConfigManager* theManager;
   G4UIcmdWithAString* hitsCmd;
+  G4UIcmdWithAString* stepLimitsCmd;
+  G4UIcmdWithADoubleAndUnit* stripLengthCmd;
+  G4UIcmdWithADoubleAndUnit* stripWidthCmd;
+  G4UIcmdWithADoubleAndUnit* stripSpacingCmd;
+  G4UIcmdWithADoubleAndUnit* filmThicknessCmd;
+  G4UIcmdWithAnInteger* nStripsCmd;
+  G4UIcmdWithAString* phononSurfaceCmd;
+  G4UIcmdWithAString* chargeSurfaceCmd;
+  G4UIcmdWithoutParameter* resetCmd;
+  G4UIcmdWithAString* outputTagCmd;
+  G4UIcommand* scanCmd;
 
 private:
   ConfigMessenger(const ConfigMessenger&);	// Copying is forbidden
@@ -17,6 +17,8 @@
 #include "G4OpticalSurface.hh"
 #include "globals.hh"
 #include "G4Args.hh"
+#include <map>
+#include <set>
 
 class G4Material;
 class G4VPhysicalVolume;
@@ -30,14 +32,30 @@ public:
   
 public:
   virtual G4VPhysicalVolume* Construct();
+  virtual void ConstructSDandField();
 
   G4LogicalVolume *GetScoringVolume() const { return fScoringVolume; }
+
+  // Volumes whose entering particles stage 1 (-writePhaseSpace) records
+  const std::set<const G4VPhysicalVolume*>& GetPhaseSpaceVolumes() const {
+    return fPhaseSpaceVolumes;
+  }
   
 private:
   void DefineMaterials();
   void SetupGeometry();
   void AttachPhononSensor(G4CMPSurfaceProperty * surfProp);
 
+  // Border surface property known as key to /g4cmp/phononSurface and
+  // /g4cmp/chargeSurface, which may override its absorption and reflection
+  G4CMPSurfaceProperty* DefineSurface(const G4String& key, const G4String& name,
+				      G4double qAbsProb, G4double qReflProb,
+				      G4double eMinK, G4double hMinK,
+				      G4double pAbsProb, G4double pReflProb,
+				      G4double pSpecProb, G4double pMinK);
+  // Refill every surface with the ConfigManager values or its own
+  void ApplySurfaceSettings();
+
   
 private:
   // G4Box *solidWorld, *solidRadiator, *solidDetector, *solidScintillator, *solidAir, *solidCu1, *solidCu2, *solidAl1, *solidAl2, *solid_strip, *solid_aSistrip;
@@ -76,8 +94,23 @@ private:
   G4CMPSurfaceProperty* faSiWSiInterface;
   // SiO2 layer to vacuum interface 
   G4CMPSurfaceProperty* fSiO2VacuumInterface;
+
+  // Surface properties by key, with the values they were defined with
+  struct SurfaceDefinition {
+    G4CMPSurfaceProperty* property;
+    G4double qAbsProb, qReflProb, eMinK, hMinK;
+    G4double pAbsProb, pReflProb, pSpecProb, pMinK;
+  };
+  std::map<G4String, SurfaceDefinition> fSurfaces;
   
-  G4CMPElectrodeSensitivity* fSuperconductorSensitivity;
+  // Volumes made sensitive in ConstructSDandField (once per thread)
+  G4LogicalVolume* fWireLogical;
+  G4LogicalVolume* fSubstrateLogical;
+  // Volumes whose hits are recorded, handed to the sensitive detector
+  std::set<const G4VPhysicalVolume*> fTargetVolumes;
+  // The copper housing and the substrate (see GetPhaseSpaceVolumes)
+  std::set<const G4VPhysicalVolume*> fPhaseSpaceVolumes;
+
   G4bool fConstructed;
   MyG4Args* PassArgs;
   //G4bool fIfField;
@@ -81,6 +81,10 @@ namespace DetectorParameters
   constexpr double dp_stripWrapInnerRadius = dp_stripSpacing / 2;
   constexpr double dp_stripWrapOuterRadius = (dp_stripSpacing + (2 * dp_stripThickness)) / 2;
   constexpr int dp_numStrips = 240;
+  // Global z of the wire mid-plane (bottom of the substrate stack, see
+  // SetupGeometry); phonon importance and step limit regions are measured
+  // from here
+  constexpr double dp_wirePlaneZ = dp_sensorDimZ - dp_SisubstrateDimZ - dp_SiO2substrateDimZ - dp_stripDimZ/2;
 }
 
 
@@ -0,0 +1,52 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef Digitizer_hh
+#define Digitizer_hh 1
+
+// $Id$
+// File:  Digitizer.hh
+//
+// Description:	End-of-event digitizer (-digitize) turning the hits of an
+//		event into the features of the SNSPD pulse: whether the
+//		meander clicked, when, on which strips, and the energy it
+//		absorbed.  Hotspot model, configured with -hotspotModel
+//		"threshold_eV:window_ns:size_um": the wire is cut into
+//		cells of the hotspot size along its length, and a cell
+//		switches when the (weighted) energy deposited in it within
+//		any window-long interval reaches the threshold.  A strip
+//		clicks at the time its first cell switches.  Hits carry
+//		their strip and path length (see MeanderSolid.hh); those
+//		in a wrap count for the nearer of the strips it joins.
+
+#include "Run.hh"
+#include "globals.hh"
+#include <vector>
+
+
+class Digitizer {
+public:
+  Digitizer(const G4String& config);
+
+  // Digitize the hits of the event that just ended in the run and add
+  // its pulse to the run
+  void Digitize(Run* run) const;
+
+private:
+  G4double threshold;		// eV
+  G4double window;		// ns
+  G4double hotspotSize;
+
+  // One hit in a cell, sorted by cell and time
+  struct CellHit {
+    G4int strip;
+    G4int cell;
+    G4double time;
+    G4double energy;		// Weighted
+  };
+  mutable std::vector<CellHit> cellHits;	// Reused between events
+};
+
+#endif	/* Digitizer_hh */
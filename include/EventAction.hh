@@ -16,6 +16,8 @@
 #include <string.h> // Functions for manipulating C-style strings
 #include "G4Args.hh" // Custom header for argument handling
 
+class Digitizer;
+
 // Declare the MyEventAction class, inheriting from G4UserEventAction
 // This class is used to define custom actions to be taken at the beginning and end of each event in a Geant4 simulation.
 class EventAction : public G4UserEventAction
@@ -33,7 +35,9 @@ public:
 
 private:
    
+    RunAction* fRunAction; // Writes buffered hits every -flushEvents events
     MyG4Args* PassArgs; // Pointer to MyG4Args for passing arguments
+    Digitizer* fDigitizer; // Pulse of every event (-digitize), else null
 };
 
 #endif
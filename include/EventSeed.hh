@@ -0,0 +1,48 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef EventSeed_hh
+#define EventSeed_hh 1
+
+// $Id$
+// File:  EventSeed.hh
+//
+// Description:	Derives the random engine seeds of an event from (master
+//		seed, run ID, event ID) alone, so any event can be replayed
+//		by itself and jobs with different seeds or event ranges draw
+//		independent streams.  Hashing is SplitMix64.
+
+#include "Randomize.hh"
+#include "globals.hh"
+#include <cstdint>
+
+namespace EventSeed
+{
+  inline std::uint64_t Mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // Two seeds in [1, 2^31-1] for the given event; eventID -1 is the master
+  inline void Derive(G4long masterSeed, G4int runID, G4long eventID,
+		     long seeds[2]) {
+    std::uint64_t state = Mix(static_cast<std::uint64_t>(masterSeed));
+    state = Mix(state ^ static_cast<std::uint64_t>(runID));
+    state = Mix(state ^ static_cast<std::uint64_t>(eventID));
+
+    seeds[0] = static_cast<long>(Mix(state)   % 0x7FFFFFFEULL) + 1;
+    seeds[1] = static_cast<long>(Mix(~state)  % 0x7FFFFFFEULL) + 1;
+  }
+
+  // Reset this thread's engine to the event's stream
+  inline void Apply(const long seeds[2]) {
+    long engineSeeds[3] = { seeds[0], seeds[1], 0 };	// Zero terminated
+    G4Random::setTheSeeds(engineSeeds);
+  }
+}
+
+#endif	/* EventSeed_hh */
@@ -2,7 +2,6 @@
 #define MY_G4_ARGS_HH
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include "G4String.hh"
 #include "G4ThreeVector.hh" // For G4ThreeVector
@@ -14,74 +13,46 @@ public:
     MyG4Args(int, char**);
     ~MyG4Args();
     
-    struct G4StringHasher {
-    std::size_t operator()(const G4String& key) const {
-        return std::hash<std::string>()(key);
-    }
-};
-
-
-    // Struct to store hit data
-    struct HitData {
-        G4double energyDeposit;
-        G4ThreeVector position;
-        G4double time;
-        // G4String particleType;
-        G4int particleType;
-    };
-
     // Getter for the output name
     const G4String& GetOutName() const { return OutName; }
 
-    // Function to add energy deposition to a particle type in the map
-    void AddToEnergyByParticleAndEvent(const G4String& particleType, G4double energyDeposit, G4int eventNumber);
-
-    // Function to add a hit record to the vector
-    void AddHitRecord(const G4double energyDeposit, const G4ThreeVector& position, 
-                    //   const G4double time, const G4String& particleType);
-                      const G4double time, const G4int intParticleType);
-
-	// Function to store a G4ThreeVector position
-	void StorePosition(const G4ThreeVector& position);
 	// Function to get a G4ThreeVector position from the gunpositions vector
     G4ThreeVector GetPosition(int i);
 
-    // Getter for hit records
-    const std::vector<HitData>& GetHitRecords() const { return hitRecords; }
-
-    // Getter for total energy by particle type for a specific event
-    const std::unordered_map<G4String, G4double, G4StringHasher>& GetTotalEnergyByParticleAndEvent(G4int eventNumber) const {
-        return totalEnergyByParticleAndEvent.at(eventNumber);  // Access energy by event number
-    }
-    
-	const std::vector<G4ThreeVector>& GetGunPositions() const {
-		return gunpositions;
-	}
-    
-	// Getter for total energy by particle type and event number
-	const std::unordered_map<G4int, std::unordered_map<G4String, G4double, G4StringHasher>>& GetTotalEnergyByParticleAndEventAll() const {
-		return totalEnergyByParticleAndEvent;  // Return the entire map
-	}
-
 	// Getter for the randomGunLocation flag
 	bool GetRandomGunLocation() const { return randomGunLocation; }
     bool GetPosResScan() const { return posResScan; }
 	bool GetAllrecord() const { return Allrecord; }
 	G4int GetRunevt() const {return runevt;}
-
-    void ResetTotalEnergyByParticleAndEvent();
-	G4double CurrentEvtEdep = 0.0;  // Ensure this is initialized
-    void ResetCurrentEvtEdep() {
-        CurrentEvtEdep = 0.0;
-    }
-
-	void AddCurrentEvtEdep(const G4double energyDeposit) {
-		// Store energy deposit for the specific event number
-		CurrentEvtEdep += energyDeposit;
-	}
-
-	const G4double GetCurrentEvtEdep() const {
-		return CurrentEvtEdep;
+	G4int GetNThreads() const {return nThreads;}
+	G4int GetFlushEvents() const {return flushEvents;}
+	std::size_t GetHitBufferBytes() const {return std::size_t(hitBufferMB) << 20;}
+	const G4String& GetRunManagerType() const {return runManagerType;}
+	G4bool WriteRootHits() const {return outputFormat != "binary" && !histogramsOnly && KeepRawHits();}
+	G4bool WriteBinaryHits() const {return outputFormat != "root" && KeepRawHits();}
+	G4bool IsDigitize() const {return digitize;}
+	const G4String& GetHotspotModel() const {return hotspotModel;}
+	// Raw hits are written unless digitizing without -keepRawHits
+	G4bool KeepRawHits() const {return !digitize || keepRawHits;}
+	G4long GetMasterSeed() const {return masterSeed;}
+	const G4String& GetPhononImportance() const {return phononImportance;}
+	const G4String& GetStepLimits() const {return stepLimits;}
+	G4bool GetProfile() const {return profile;}
+	const G4String& GetPhysicsCache() const {return physicsCache;}
+	G4bool WritePhaseSpace() const {return writePhaseSpace;}
+	const G4String& GetPhaseSpaceInput() const {return phaseSpaceInput;}
+	G4bool WriteDeposits() const {return writeDeposits;}
+	const G4String& GetDepositInput() const {return depositInput;}
+	G4bool IsDepositReplay() const {return !depositInput.empty();}
+	G4int GetRealizations() const {return realizations;}
+	G4long GetPhononBudget() const {return phononBudget;}
+	G4long GetLukeBudget() const {return lukeBudget;}
+	G4bool IsReplay() const {return replayEvent >= 0;}
+	// Event ID of the first event of this job; local IDs are offset by it
+	G4int GetFirstEvent() const {return IsReplay() ? replayEvent : shardFirst;}
+	// Events this job runs: one when replaying, its slice when sharded
+	G4int GetEventsToRun() const {
+		return IsReplay() ? 1 : (nShards > 1 ? shardEvents : runevt);
 	}
 
     G4String GetMacName() {
@@ -121,13 +92,34 @@ private:
     G4String particleName = "proton";
     G4int nParticles = 1;  // Number of particles per event to generate
     G4double globalTimeCut = -1;  // ns
-	//G4double CurrentEvtEdep = 0;
+    G4String runManagerType = "serial";  // serial, mt or tasking
+    G4int nThreads = 0;  // Worker threads, 0 leaves the run manager default
+    G4int flushEvents = 1;  // Write hits every N events, 0 buffers the whole run
+    G4long hitBufferMB = 0;  // Hits kept in memory per thread, the rest spill to disk (see HitSpool.hh); 0 is unbounded
+    G4String outputFormat = "root";  // Hit output: root, binary or both
+    G4bool histogramsOnly = false;  // Leave the Hits ntuple empty, keep the hit histograms
+    G4bool digitize = false;  // Write per-event pulse features (see Digitizer.hh)
+    G4String hotspotModel;  // "threshold_eV:window_ns:size_um", empty keeps the defaults
+    G4bool keepRawHits = false;  // Write the hits as well when digitizing
+    G4long masterSeed = 0;  // Event seeds derive from this, run and event ID
+    G4int replayEvent = -1;  // Rerun just this event, -1 runs them all
+    G4String phononImportance;  // "d_um:I,..." (see PhononImportance.hh), empty is unbiased
+    G4String stepLimits;  // "volume:class:step_nm[:within_um],..." (see StepLimits.hh), empty keeps the defaults
+    G4bool profile = false;  // Time steps by volume, particle and process (see StepProfile.hh)
+    G4String physicsCache;  // Store and retrieve the physics tables here (see PhysicsCache.hh), empty builds them every time
+    G4bool writePhaseSpace = false;  // Stage 1: save and stop particles reaching the chip housing
+    G4String phaseSpaceInput;  // Stage 2: replay this phase-space file instead of the gun
+    G4bool writeDeposits = false;  // Save energy deposits in the lattice volumes
+    G4String depositInput;  // Regenerate phonons from this deposit file, with G4CMP physics only
+    G4int realizations = 1;  // Sub-events per replayed deposit event
+    G4long phononBudget = 0;  // Prompt phonons (and charges) per event, 0 keeps all (see StackingAction.hh)
+    G4long lukeBudget = 0;  // Luke phonons per event, 0 keeps all
+    G4int shardIndex = 0;  // -shard i/N
+    G4int nShards = 1;
+    G4int shardFirst = 0;  // First event and number of events of this shard
+    G4int shardEvents = 0;
 	
-    std::vector<G4ThreeVector> gunpositions; // Vector to store position data
-
-    std::unordered_map<G4String, G4double, G4StringHasher> totalEnergyByParticle; // Total energy by particle type
-    std::unordered_map<G4int, std::unordered_map<G4String, G4double, G4StringHasher>> totalEnergyByParticleAndEvent; // Energy by event and particle type
-    std::vector<HitData> hitRecords; // Vector to store hit data
+    std::vector<G4ThreeVector> gunpositions; // Precomputed gun positions (-PosResScan)
 
     G4ThreeVector ConvertToPos(std::string posName="outsideCryostat") {  // By default in CLHEP lengths are in mm and energy is in MeV
         if (posName == "insideCryostat") {
@@ -0,0 +1,105 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef HitColumns_hh
+#define HitColumns_hh 1
+
+// $Id$
+// File:  HitColumns.hh
+//
+// Description:	Hit store of a run, one contiguous array per field
+//		(structure of arrays).  Energies are in eV and times in ns,
+//		positions and path lengths in Geant4 units.  Hits are added
+//		one at a time as they are made and appended in bulk when
+//		runs are merged or spilled hits are read back.  Writers
+//		convert and copy whole columns (see BinaryHitWriter), and
+//		ForEachColumn() lets generic code such as the spill file
+//		(HitSpool) treat every column alike.
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <vector>
+
+
+class HitColumns {
+public:
+  std::vector<G4int> eventID;
+  std::vector<G4int> subEvent;		// Realization of a replayed event, else 0
+  std::vector<G4double> energyDeposit;	// eV
+  std::vector<G4double> x;		// Geant4 length units
+  std::vector<G4double> y;
+  std::vector<G4double> z;
+  std::vector<G4double> time;		// ns
+  std::vector<G4int> particleType;
+  std::vector<G4double> weight;		// Track weight (importance biasing)
+  std::vector<G4int> trackID;
+  std::vector<G4int> strip;		// Where on the meander, see MeanderSolid.hh
+  std::vector<G4int> segment;
+  std::vector<G4double> pathLength;	// Geant4 length units
+
+  // Bytes one hit takes over all columns
+  static std::size_t HitSize();
+
+  std::size_t size() const { return eventID.size(); }
+  G4bool empty() const { return eventID.empty(); }
+
+  void Add(G4int event, G4int sub, G4double energy,
+	   const G4ThreeVector& position, G4double hitTime, G4int particle,
+	   G4double trackWeight, G4int track, G4int hitStrip,
+	   G4int hitSegment, G4double hitPathLength);
+
+  // Append hits [begin, end) of other
+  void Append(const HitColumns& other, std::size_t begin, std::size_t end);
+  void Append(const HitColumns& other) { Append(other, 0, other.size()); }
+
+  // Keep the first n hits
+  void Resize(std::size_t n);
+  void Clear() { Resize(0); }		// Capacity is kept
+
+  // Stable sort by (eventID, subEvent), keeping each event's hit order
+  void SortByEvent();
+
+  // Order of the events of hit i and hit j of other
+  G4bool EventBefore(std::size_t i, const HitColumns& other,
+		     std::size_t j) const {
+    return (eventID[i] < other.eventID[j] ||
+	    (eventID[i] == other.eventID[j] &&
+	     subEvent[i] < other.subEvent[j]));
+  }
+  G4bool SameEvent(std::size_t i, G4int event, G4int sub) const {
+    return eventID[i] == event && subEvent[i] == sub;
+  }
+
+  // Call f(column) on every column in turn, or f(column, otherColumn)
+  // in step with another store
+  template <class F> void ForEachColumn(F f) {
+    Visit(*this, *this, [&f](auto& column, auto&) { f(column); });
+  }
+  template <class F> void ForEachColumn(F f) const {
+    Visit(*this, *this, [&f](auto& column, auto&) { f(column); });
+  }
+  template <class F> void ForEachColumn(const HitColumns& other, F f) {
+    Visit(*this, other, f);
+  }
+
+private:
+  template <class A, class B, class F> static void Visit(A& a, B& b, F f) {
+    f(a.eventID, b.eventID);
+    f(a.subEvent, b.subEvent);
+    f(a.energyDeposit, b.energyDeposit);
+    f(a.x, b.x);
+    f(a.y, b.y);
+    f(a.z, b.z);
+    f(a.time, b.time);
+    f(a.particleType, b.particleType);
+    f(a.weight, b.weight);
+    f(a.trackID, b.trackID);
+    f(a.strip, b.strip);
+    f(a.segment, b.segment);
+    f(a.pathLength, b.pathLength);
+  }
+};
+
+#endif	/* HitColumns_hh */
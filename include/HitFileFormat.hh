@@ -0,0 +1,99 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef HitFileFormat_hh
+#define HitFileFormat_hh 1
+
+// $Id$
+// File:  HitFileFormat.hh
+//
+// Description:	On-disk layout of the columnar binary hit file written by
+//		BinaryHitWriter and read by HitFileReader.  Deliberately
+//		free of Geant4 headers so analysis tools can use it alone.
+//
+//		File   = FileHeader, ColumnInfo[nColumns], Block...,
+//		         [IndexHeader, IndexEntry[nEvents]]
+//		Block  = BlockHeader, then one array per column in the order
+//		         of the column table, each padded to 8 bytes
+//
+//		Blocks are self-contained and only ever appended, so a file
+//		cut short by a crash is still readable up to its last block.
+//		The hits of an event are contiguous within one block; the
+//		event index written on close gives each event's first hit
+//		(counting from the start of the file) and number of hits.
+//		Readers rebuild the index from the EventID and SubEvent
+//		columns when it is missing.
+//		Units: energy [eV], position and path length [um], time [ns].
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HitFileFormat
+{
+  constexpr char kMagic[8] = {'S','N','S','P','D','H','I','T'};
+  constexpr std::uint32_t kVersion = 3;	// 3: TrackID column, event index
+  constexpr std::uint32_t kByteOrderMark = 0x01020304;
+  constexpr std::uint32_t kBlockMagic = 0x4B4C4248;	// "HBLK"
+  constexpr std::uint32_t kIndexMagic = 0x58444948;	// "HIDX"
+
+  enum ColumnType : std::uint8_t {
+    kInt32 = 1,
+    kFloat32 = 2,
+    kUInt8 = 3
+  };
+
+  struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t nColumns;
+    std::uint32_t reserved;
+    std::uint64_t nBlocks;	// Filled on close; readers rescan if zero
+    std::uint64_t nHits;
+    std::int64_t firstEvent;	// Event IDs the job ran (see -shard),
+    std::int64_t nEvents;	// with or without hits
+  };
+  static_assert(sizeof(FileHeader) == 56, "FileHeader layout changed");
+
+  struct ColumnInfo {
+    char name[23];		// NUL terminated
+    std::uint8_t type;		// ColumnType
+  };
+  static_assert(sizeof(ColumnInfo) == 24, "ColumnInfo layout changed");
+
+  struct BlockHeader {
+    std::uint32_t magic;
+    std::uint32_t nHits;
+    std::uint64_t blockBytes;	// Including this header
+  };
+  static_assert(sizeof(BlockHeader) == 16, "BlockHeader layout changed");
+
+  struct IndexHeader {
+    std::uint32_t magic;
+    std::uint32_t reserved;
+    std::uint64_t nEvents;
+  };
+  static_assert(sizeof(IndexHeader) == 16, "IndexHeader layout changed");
+
+  // Events without hits have no entry
+  struct IndexEntry {
+    std::int32_t eventID;
+    std::int32_t subEvent;
+    std::uint64_t firstHit;
+    std::uint32_t nHits;
+    std::uint32_t block;
+  };
+  static_assert(sizeof(IndexEntry) == 24, "IndexEntry layout changed");
+
+  inline std::size_t ElementSize(std::uint8_t type) {
+    return (type == kUInt8) ? 1 : 4;
+  }
+
+  inline std::size_t Padded(std::size_t nBytes) {
+    return (nBytes + 7) & ~std::size_t(7);
+  }
+}
+
+#endif	/* HitFileFormat_hh */
@@ -0,0 +1,117 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef HitFileReader_hh
+#define HitFileReader_hh 1
+
+// $Id$
+// File:  HitFileReader.hh
+//
+// Description:	Zero-copy reader for the columnar binary hit file (see
+//		HitFileFormat.hh).  The file is memory mapped and every
+//		Block hands out pointers straight into the mapping.
+//
+//		  HitFileReader reader;
+//		  reader.Open("Results/sim_output.hits");
+//		  int iE = reader.FindColumn("EnergyDeposit");
+//		  reader.ForEachBlock([&](const HitFileReader::Block& b) {
+//		    const float* eDep = b.Column<float>(iE);
+//		    for (std::uint32_t i=0; i<b.size(); ++i) sum += eDep[i];
+//		  });
+//
+//		GetEventHits() looks an event up in the event index and
+//		returns its hits as a (smaller) Block, without a scan.
+
+#include "HitFileFormat.hh"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class HitFileReader {
+public:
+  // One block of hits: a view into the mapped file, valid while the
+  // reader stays open
+  class Block {
+  public:
+    std::uint32_t size() const { return nHits; }
+
+    template <typename T> const T* Column(int index) const {
+      return (index < 0 || index >= (int)columns.size()) ? nullptr
+	: reinterpret_cast<const T*>(columns[index]);
+    }
+
+  private:
+    friend class HitFileReader;
+    std::uint32_t nHits = 0;
+    std::vector<const char*> columns;
+  };
+
+  HitFileReader();
+  ~HitFileReader();
+
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const { return data != nullptr; }
+
+  const std::vector<HitFileFormat::ColumnInfo>& GetColumns() const {
+    return columnTable;
+  }
+
+  // Index of the named column, or -1 if the file does not have it
+  int FindColumn(const std::string& name) const;
+
+  std::size_t GetNumBlocks() const { return blockOffsets.size(); }
+  std::uint64_t GetNumHits() const { return nHits; }
+
+  // Event IDs the writing job ran, GetFirstEvent() up to
+  // GetFirstEvent() + GetNumEvents() - 1, including those without hits
+  std::int64_t GetFirstEvent() const { return firstEvent; }
+  std::int64_t GetNumEvents() const { return nEvents; }
+
+  Block GetBlock(std::size_t i) const;
+
+  template <typename Fn> void ForEachBlock(Fn fn) const {
+    for (std::size_t i=0; i<blockOffsets.size(); ++i) fn(GetBlock(i));
+  }
+
+  // Events with hits, in file order; read from the file, or rebuilt if
+  // the writer never got to write it
+  const std::vector<HitFileFormat::IndexEntry>& GetEventIndex() const {
+    return eventIndex;
+  }
+  bool HasSavedIndex() const { return savedIndex; }
+
+  // The entry of one event, or null if it has no hits in this file
+  const HitFileFormat::IndexEntry* FindEvent(int eventID, int subEvent=0) const;
+
+  // The hits of one event; empty if it has none
+  Block GetEventHits(int eventID, int subEvent=0) const;
+
+private:
+  HitFileReader(const HitFileReader&) = delete;
+  HitFileReader& operator=(const HitFileReader&) = delete;
+
+  bool ReadIndex(std::size_t offset);
+  void BuildIndex();
+
+  static std::uint64_t Key(int eventID, int subEvent) {
+    return (std::uint64_t(std::uint32_t(eventID)) << 32) | std::uint32_t(subEvent);
+  }
+
+  const char* data;
+  std::size_t dataSize;
+  std::vector<HitFileFormat::ColumnInfo> columnTable;
+  std::vector<std::size_t> blockOffsets;
+  std::vector<std::uint64_t> blockFirstHits;
+  std::uint64_t nHits;
+  std::int64_t firstEvent;
+  std::int64_t nEvents;
+  std::vector<HitFileFormat::IndexEntry> eventIndex;
+  std::unordered_map<std::uint64_t, std::size_t> eventLookup;
+  bool savedIndex;
+};
+
+#endif	/* HitFileReader_hh */
@@ -0,0 +1,73 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef HitSpool_hh
+#define HitSpool_hh 1
+
+// $Id$
+// File:  HitSpool.hh
+//
+// Description:	Overflow of a run's hit buffer (-hitBufferMB).  When the
+//		buffer is over budget its hits are sorted by event and
+//		spilled as one chunk, column after column, to a temporary
+//		file in $TMPDIR (/tmp if unset), removed as soon as it is
+//		opened so it goes away with the process.  When the hits
+//		are written the chunks are merged back in event order, a
+//		buffer's worth of whole events at a time.  Chunks are
+//		shared, not copied, when a worker run is merged into the
+//		master's.
+
+#include "HitColumns.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+
+class HitSpool {
+public:
+  HitSpool();
+  ~HitSpool();
+
+  // Sort the hits by event and move them to a new chunk; the columns
+  // are left empty but keep their capacity
+  void Spill(HitColumns& hits);
+
+  // Take over the chunks of another spool (a worker's, on the master)
+  void Merge(const HitSpool& other);
+
+  G4bool IsEmpty() const { return chunks.empty(); }
+  std::uint64_t GetNumberOfHits() const { return nHits; }
+
+  // Replace hits with the next whole events in event order, about
+  // maxHits of them; false once every chunk has been read
+  G4bool Read(HitColumns& hits, std::size_t maxHits);
+
+  // Forget all chunks; a file is closed when no spool refers to it
+  void Clear();
+
+private:
+  HitSpool(const HitSpool&) = delete;
+  HitSpool& operator=(const HitSpool&) = delete;
+
+  struct Chunk {
+    std::shared_ptr<std::FILE> file;
+    long offset;			// Of the chunk's first column
+    std::size_t nHits;
+    std::size_t nRead;			// Hits read ahead so far
+    HitColumns buffer;			// Read ahead, consumed from next
+    std::size_t next;
+  };
+
+  // Make sure the chunk has a hit to consume; false when it is done
+  G4bool Fill(Chunk& chunk, std::size_t readAhead) const;
+
+  std::shared_ptr<std::FILE> file;	// This spool's, opened on first spill
+  std::vector<Chunk> chunks;
+  std::uint64_t nHits;
+};
+
+#endif	/* HitSpool_hh */
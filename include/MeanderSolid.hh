@@ -0,0 +1,153 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef MeanderSolid_hh
+#define MeanderSolid_hh 1
+
+// $Id$
+// File:  MeanderSolid.hh
+//
+// Description:	Solid for the SNSPD meander: nStrips parallel strips along
+//		x at a regular pitch in y, joined alternately at +x and -x
+//		by half-ring wraps.  Equivalent to the G4MultiUnion of one
+//		G4Box per strip and one G4Tubs per wrap, but every query
+//		picks the one or two strips and wraps it can concern from
+//		the pitch instead of searching all of them.
+//
+//		MeanderLayout::Locate() places a point along the wire in
+//		constant time: its strip, its segment and its distance
+//		along the centre line of the wire.
+//		Strip i is centred at y_i = firstStripY + i*pitch; wrap j
+//		(between strips j and j+1) is centred at y_j + pitch/2, on
+//		the +x end for even j and the -x end for odd j.  The solid
+//		is centred on z = 0.
+
+#include "G4VSolid.hh"
+#include "G4ThreeVector.hh"
+
+class G4Box;
+class G4MultiUnion;
+class G4Tubs;
+
+
+// Where a point lies along the meander
+struct MeanderPosition {
+  G4int strip;			// Nearest strip
+  G4int segment;		// 2i for strip i, 2j+1 for wrap j
+  G4double pathLength;		// Along the centre line from the -x end
+};				// of strip 0, where the wire starts
+
+
+// Dimensions of the meander; the defaults come from DetectorParameters
+struct MeanderLayout {
+  G4double stripLength;		// x extent of a strip
+  G4double stripWidth;		// y extent of a strip (dp_stripThickness)
+  G4double stripSpacing;	// Gap between neighbouring strips
+  G4double filmThickness;	// z extent
+  G4double firstStripY;		// Centre of strip 0
+  G4int nStrips;
+
+  G4double Pitch() const { return stripWidth + stripSpacing; }
+  G4double InnerRadius() const { return stripSpacing/2; }
+  G4double OuterRadius() const { return stripSpacing/2 + stripWidth; }
+  G4double StripY(G4int i) const { return firstStripY + i*Pitch(); }
+
+  // Strip or wrap (of the given parity: 0 at +x, 1 at -x) nearest to y;
+  // NearestWrap is -1 if there is no wrap of that parity
+  G4int NearestStrip(G4double y) const;
+  G4int NearestWrap(G4double y, G4int parity) const;
+
+  // The wrap centre lines are half circles of radius Pitch()/2
+  G4double WireLength() const;
+  MeanderPosition Locate(const G4ThreeVector& p) const;	// Meander frame
+
+  static MeanderLayout FromDetectorParameters();
+};
+
+
+class MeanderSolid : public G4VSolid {
+public:
+  MeanderSolid(const G4String& name, const MeanderLayout& layout);
+  MeanderSolid(const MeanderSolid& rhs);
+  virtual ~MeanderSolid();
+
+  const MeanderLayout& GetLayout() const { return fLayout; }
+
+  // The equivalent union built from this solid's primitives, for
+  // visualization and for validating/benchmarking against
+  G4MultiUnion* BuildMultiUnion(const G4String& name) const;
+
+  virtual EInside Inside(const G4ThreeVector& p) const;
+  virtual G4ThreeVector SurfaceNormal(const G4ThreeVector& p) const;
+  virtual G4double DistanceToIn(const G4ThreeVector& p,
+				const G4ThreeVector& v) const;
+  virtual G4double DistanceToIn(const G4ThreeVector& p) const;
+  virtual G4double DistanceToOut(const G4ThreeVector& p,
+				 const G4ThreeVector& v,
+				 const G4bool calcNorm=false,
+				 G4bool* validNorm=nullptr,
+				 G4ThreeVector* n=nullptr) const;
+  virtual G4double DistanceToOut(const G4ThreeVector& p) const;
+
+  virtual void BoundingLimits(G4ThreeVector& pMin, G4ThreeVector& pMax) const;
+  virtual G4bool CalculateExtent(const EAxis pAxis,
+				 const G4VoxelLimits& pVoxelLimit,
+				 const G4AffineTransform& pTransform,
+				 G4double& pMin, G4double& pMax) const;
+
+  virtual G4double GetCubicVolume();
+  virtual G4double GetSurfaceArea();
+  virtual G4ThreeVector GetPointOnSurface() const;
+
+  virtual G4GeometryType GetEntityType() const { return "MeanderSolid"; }
+  virtual G4VSolid* Clone() const { return new MeanderSolid(*this); }
+  virtual std::ostream& StreamInfo(std::ostream& os) const;
+
+  virtual void DescribeYourselfTo(G4VGraphicsScene& scene) const;
+  virtual G4Polyhedron* CreatePolyhedron() const;
+
+private:
+  void MakePrimitives();
+
+  // A strip (index i) or a wrap (index j)
+  struct Part {
+    G4bool isWrap;
+    G4int index;
+  };
+
+  G4double StripY(G4int i) const { return fLayout.firstStripY + i*fPitch; }
+  G4int NearestStrip(G4double y) const;
+  G4int NearestWrap(G4double y, G4int parity) const;	// -1 if none
+
+  // The parts that can contain or touch p: at most a strip and a wrap
+  G4int PartsNear(const G4ThreeVector& p, Part parts[2]) const;
+
+  // Part-local coordinates and back
+  G4ThreeVector ToLocal(const Part& part, const G4ThreeVector& p) const;
+  G4ThreeVector DirToLocal(const Part& part, const G4ThreeVector& v) const;
+  G4ThreeVector DirToGlobal(const Part& part, const G4ThreeVector& v) const;
+  const G4VSolid* Primitive(const Part& part) const;
+
+  EInside PartInside(const Part& part, const G4ThreeVector& p) const;
+  G4double PartDistanceToIn(const Part& part, const G4ThreeVector& p,
+			    const G4ThreeVector& v) const;
+  G4double PartDistanceToOut(const Part& part, const G4ThreeVector& p,
+			     const G4ThreeVector& v, G4ThreeVector& n) const;
+
+  // Ray parameters [tMin, tMax] inside the bounding box, false if missed
+  G4bool ClipToBox(const G4ThreeVector& p, const G4ThreeVector& v,
+		   G4double& tMin, G4double& tMax) const;
+
+  MeanderLayout fLayout;
+  G4double fPitch;
+  G4double fHalfTolerance;
+  G4ThreeVector fMin, fMax;	// Bounding box
+  G4Box* fStrip;		// Shared by all strips, centred on the origin
+  G4Tubs* fWrap;		// Shared by all wraps, the half at local y >= 0
+  G4double fCubicVolume;
+  G4double fSurfaceArea;
+};
+
+#endif	/* MeanderSolid_hh */
@@ -0,0 +1,57 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef ParticleCode_hh
+#define ParticleCode_hh 1
+
+// $Id$
+// File:  ParticleCode.hh
+//
+// Description:	Small integer codes for the particle classes that deposit
+//		energy in the wire.  The code is written to the ParticleType
+//		column of the hits and indexes the per-event energy sums, so
+//		existing values must never be renumbered.
+
+namespace ParticleCode
+{
+  enum Code {
+    kProton       = 0,		// Either sign, as the old name match did
+    kPhononL      = 1,
+    kPhononTS     = 2,
+    kPhononTF     = 3,
+    kOther        = 4,		// Neutral species not listed below
+    kElectron     = 5,
+    kPositron     = 6,
+    kGamma        = 7,
+    kMuon         = 8,		// Either sign
+    kPion         = 9,		// Charged, either sign
+    kNeutron      = 10,
+    kOtherCharged = 11,		// Kaons, ions, ...
+    kNCodes
+  };
+
+  inline bool IsPhonon(int code) {
+    return code >= kPhononL && code <= kPhononTF;
+  }
+
+  inline const char* Name(int code) {
+    switch (code) {
+    case kProton:       return "proton";
+    case kPhononL:      return "phononL";
+    case kPhononTS:     return "phononTS";
+    case kPhononTF:     return "phononTF";
+    case kElectron:     return "e-";
+    case kPositron:     return "e+";
+    case kGamma:        return "gamma";
+    case kMuon:         return "mu";
+    case kPion:         return "pi";
+    case kNeutron:      return "neutron";
+    case kOtherCharged: return "otherCharged";
+    default:            return "other";
+    }
+  }
+}
+
+#endif	/* ParticleCode_hh */
@@ -0,0 +1,87 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhaseSpaceFormat_hh
+#define PhaseSpaceFormat_hh 1
+
+// $Id$
+// File:  PhaseSpaceFormat.hh
+//
+// Description:	On-disk layout of the phase-space file written by stage 1
+//		(-writePhaseSpace) and replayed by stage 2 (-readPhaseSpace).
+//		One record per particle entering the chip housing or the
+//		substrate, grouped by event; the per-event index is written
+//		at the end when the file is closed.
+//
+//		The same layout holds the energy deposits saved with
+//		-writeDeposits and replayed as phonon sources with
+//		-replayDeposits; the header says which records a file holds.
+//
+//		File = FileHeader, Record... (or Deposit...),
+//		       IndexEntry[nEvents]
+//
+//		Units: position [mm], energy [MeV], time [ns].
+
+#include <cstdint>
+
+namespace PhaseSpaceFormat
+{
+  constexpr char kMagic[8] = {'S','N','S','P','D','P','S','F'};
+  constexpr std::uint32_t kVersion = 2;
+  constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+  enum RecordType : std::uint32_t {
+    kParticleRecords = 0,	// Record
+    kDepositRecords = 1,	// Deposit
+    kNRecordTypes
+  };
+
+  struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint64_t nRecords;
+    std::uint64_t nEvents;
+    std::uint64_t indexOffset;	// Zero until the writer closes the file
+    std::uint32_t recordType;	// RecordType
+    std::uint32_t recordSize;	// sizeof(Record) or sizeof(Deposit)
+  };
+  static_assert(sizeof(FileHeader) == 48, "FileHeader layout changed");
+
+  struct Record {
+    std::int32_t eventID;
+    std::int32_t pdgCode;	// Ions as 100ZZZAAAI
+    double position[3];
+    double direction[3];
+    double kineticEnergy;
+    double time;		// Global time since the primary started
+    double weight;
+  };
+  static_assert(sizeof(Record) == 80, "Record layout changed");
+
+  // Energy left in a lattice volume by one step of a particle that is not
+  // a phonon or charge carrier, at the middle of the step
+  struct Deposit {
+    std::int32_t eventID;	// First, as in Record
+    std::int32_t pdgCode;	// Of the depositing particle
+    double position[3];
+    double energy;		// Total energy deposit
+    double nonIonizing;		// Of which non-ionizing (NIEL)
+    double time;
+    double weight;
+  };
+  static_assert(sizeof(Deposit) == 64, "Deposit layout changed");
+
+  // Every stage-1 (or deposit-saving) event has an entry, including those with no records
+  struct IndexEntry {
+    std::int32_t eventID;
+    std::uint32_t nRecords;
+    std::uint64_t firstRecord;
+    double gunPosition[3];	// Of the stage-1 primary
+  };
+  static_assert(sizeof(IndexEntry) == 40, "IndexEntry layout changed");
+}
+
+#endif	/* PhaseSpaceFormat_hh */
@@ -0,0 +1,60 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhaseSpaceReader_hh
+#define PhaseSpaceReader_hh 1
+
+// $Id$
+// File:  PhaseSpaceReader.hh
+//
+// Description:	Memory-mapped reader for phase-space files (see
+//		PhaseSpaceFormat.hh).  Events are available in event-ID
+//		order; records point straight into the mapping, so every
+//		thread can read the same file through its own reader.
+//		Reads particle (stage-1) and energy-deposit files alike.
+
+#include "PhaseSpaceFormat.hh"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+class PhaseSpaceReader {
+public:
+  // The records of one event: a view into the mapped file.  Only the
+  // pointer matching the file's record type is set.
+  struct Event {
+    const PhaseSpaceFormat::IndexEntry* entry;
+    const PhaseSpaceFormat::Record* records;
+    const PhaseSpaceFormat::Deposit* deposits;
+  };
+
+  PhaseSpaceReader();
+  ~PhaseSpaceReader();
+
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const { return data != nullptr; }
+
+  PhaseSpaceFormat::RecordType GetRecordType() const { return recordType; }
+  std::size_t GetNumEvents() const { return index.size(); }
+  std::uint64_t GetNumRecords() const { return nRecords; }
+
+  // The i-th event in event-ID order
+  Event GetEvent(std::size_t i) const;
+
+private:
+  PhaseSpaceReader(const PhaseSpaceReader&) = delete;
+  PhaseSpaceReader& operator=(const PhaseSpaceReader&) = delete;
+
+  const char* data;
+  std::size_t dataSize;
+  std::vector<PhaseSpaceFormat::IndexEntry> index;
+  std::uint64_t nRecords;
+  PhaseSpaceFormat::RecordType recordType;
+  std::size_t recordSize;
+};
+
+#endif	/* PhaseSpaceReader_hh */
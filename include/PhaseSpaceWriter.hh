@@ -0,0 +1,67 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhaseSpaceWriter_hh
+#define PhaseSpaceWriter_hh 1
+
+// $Id$
+// File:  PhaseSpaceWriter.hh
+//
+// Description:	Singleton writers for the stage-1 phase-space file
+//		(-writePhaseSpace) and the energy-deposit file
+//		(-writeDeposits), one per record type (see
+//		PhaseSpaceFormat.hh).  The master opens and closes the file;
+//		any thread may append the records of the events it has
+//		buffered, one flush at a time.
+
+#include "PhaseSpaceFormat.hh"
+#include "Run.hh"
+#include "G4Threading.hh"
+#include "globals.hh"
+#include <cstdio>
+#include <vector>
+
+
+class PhaseSpaceWriter {
+public:
+  ~PhaseSpaceWriter();
+  static PhaseSpaceWriter* Instance(PhaseSpaceFormat::RecordType type =
+				     PhaseSpaceFormat::kParticleRecords);
+
+  void Open(const G4String& fileName);
+  void Close();
+  G4bool IsOpen() const { return file != 0; }
+
+  // Append the records of the given events; records must be grouped by
+  // event in the order of events.  Safe to call from worker threads.
+  void WriteEvents(const std::vector<PhaseSpaceFormat::Record>& records,
+		   const std::vector<Run::EventData>& events);
+  void WriteEvents(const std::vector<PhaseSpaceFormat::Deposit>& deposits,
+		   const std::vector<Run::EventData>& events);
+
+private:
+  // Singleton: only constructed on request
+  PhaseSpaceWriter(PhaseSpaceFormat::RecordType type, std::size_t size);
+  PhaseSpaceWriter(const PhaseSpaceWriter&) = delete;
+  PhaseSpaceWriter& operator=(const PhaseSpaceWriter&) = delete;
+
+  static PhaseSpaceWriter* theInstances[PhaseSpaceFormat::kNRecordTypes];
+
+  void FillHeader(PhaseSpaceFormat::FileHeader& header) const;
+
+  // Records of either type start with their event ID
+  void WriteRecords(PhaseSpaceFormat::RecordType type, const char* records,
+		    std::size_t count, const std::vector<Run::EventData>& events);
+
+  const PhaseSpaceFormat::RecordType recordType;
+  const std::size_t recordSize;
+  std::FILE* file;
+  G4String fileName;
+  G4Mutex fileMutex;
+  std::uint64_t nRecords;
+  std::vector<PhaseSpaceFormat::IndexEntry> index;	// Written on Close()
+};
+
+#endif	/* PhaseSpaceWriter_hh */
@@ -0,0 +1,45 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhononImportance_hh
+#define PhononImportance_hh 1
+
+// $Id$
+// File:  PhononImportance.hh
+//
+// Description:	Geometry importance biasing for phonon tracks.  Importance
+//		is piecewise constant in the distance from the wire plane,
+//		configured with -phononImportance "d1:I1,d2:I2,...", where
+//		distances are in um and I_k applies up to d_k (the last
+//		value applies beyond).  A phonon stepping into higher
+//		importance is split into I_new/I_old copies; one stepping
+//		into lower importance survives with probability
+//		I_new/I_old.  Weights are adjusted so that weighted sums
+//		stay unbiased.
+
+#include "G4ThreeVector.hh"
+#include "G4TrackVector.hh"
+#include "globals.hh"
+#include <utility>
+#include <vector>
+
+class G4Step;
+
+
+class PhononImportance {
+public:
+  PhononImportance(const G4String& config);
+
+  G4double GetImportance(const G4ThreeVector& position) const;
+
+  // Split or roulette the step's (phonon) track; new tracks are appended
+  // to secondaries
+  void Apply(const G4Step* step, G4TrackVector* secondaries) const;
+
+private:
+  std::vector<std::pair<G4double, G4double> > cells;	// (max distance, I)
+};
+
+#endif	/* PhononImportance_hh */
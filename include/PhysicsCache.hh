@@ -0,0 +1,38 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhysicsCache_hh
+#define PhysicsCache_hh 1
+
+// $Id$
+// File:  PhysicsCache.hh
+//
+// Description:	Cache of the built physics tables (-physicsCache dir).
+//		Tables are stored with G4VUserPhysicsList::StorePhysicsTable
+//		in a subdirectory named by a hash of the configuration they
+//		depend on: Geant4 version and data sets, the physics
+//		constructors of the list, the production cuts and every
+//		material.  A later job with the same configuration
+//		retrieves them instead of building them; processes that
+//		cannot be retrieved (G4CMP's) are built as usual.
+
+#include "globals.hh"
+#include <string>
+
+class G4VModularPhysicsList;
+
+namespace PhysicsCache
+{
+  // Text the cache is keyed by; the materials must already be defined
+  std::string Key(const G4VModularPhysicsList* physics);
+
+  // Build the physics tables now (BeamOn(0)), retrieving them from
+  // cacheDir if a previous job stored this configuration, and storing
+  // them there otherwise.  Call after G4RunManager::Initialize(); true
+  // if the tables were retrieved.
+  G4bool Prepare(G4VModularPhysicsList* physics, const G4String& cacheDir);
+}
+
+#endif	/* PhysicsCache_hh */
@@ -0,0 +1,23 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef PhysicsList_hh
+#define PhysicsList_hh 1
+
+// $Id$
+// File:  PhysicsList.hh
+//
+// Description:	The physics list of the simulation (FTFP_BERT with G4CMP,
+//		optical, Livermore EM and step limiter physics), shared by
+//		SNSPDHighEnergy and the benchmarks so both run the same
+//		physics.  The phonon-only list for -replayDeposits has the
+//		G4CMP processes and nothing else.
+
+class G4VModularPhysicsList;
+
+G4VModularPhysicsList* CreatePhysicsList();
+G4VModularPhysicsList* CreatePhononPhysicsList();
+
+#endif	/* PhysicsList_hh */
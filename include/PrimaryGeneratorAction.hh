@@ -20,6 +20,9 @@
 class G4ParticleGun;
 class G4GeneralParticleSource;
 class G4Event;
+class G4CMPEnergyPartition;
+class PhaseSpaceReader;
+class Run;
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
@@ -31,7 +34,16 @@ public:
     virtual void GeneratePrimaries(G4Event*);
 
   private:
+    // Stage 2 (-readPhaseSpace): one vertex per particle saved by stage 1
+    void GeneratePhaseSpace(G4Event* anEvent, G4int eventID, Run* run);
+
+    // -replayDeposits: phonons and charges from each saved energy deposit
+    void GenerateDeposits(G4Event* anEvent, G4int eventID, Run* run);
+
     G4ParticleGun* fParticleGun;
+    PhaseSpaceReader* fPhaseSpace;  // Null unless -readPhaseSpace is given
+    PhaseSpaceReader* fDeposits;  // Null unless -replayDeposits is given
+    G4CMPEnergyPartition* fPartition;
     MyG4Args* PassArgs;
 
 };
@@ -0,0 +1,196 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef Run_hh
+#define Run_hh 1
+
+// $Id$
+// File:  Run.hh
+//
+// Description:	Per-thread container for the hits and per-event energy
+//		sums collected during a run; the master merges the workers'
+//		Runs in RunAction.  Holds the hit buffer (see HitColumns.hh)
+//		and its overflow on disk (see HitSpool.hh), a table of
+//		per-event sums by particle class, the run statistics and
+//		step profile, and with -digitize each event's pulse (see
+//		Digitizer.hh).
+
+#include "G4Run.hh"
+#include "G4String.hh"
+#include "G4ThreeVector.hh"
+#include "HitColumns.hh"
+#include "MeanderSolid.hh"
+#include "ParticleCode.hh"
+#include "PhaseSpaceFormat.hh"
+#include "RunSummary.hh"
+#include "StepProfile.hh"
+#include <array>
+#include <vector>
+
+class HitSpool;
+
+
+class Run : public G4Run {
+public:
+  using EnergyByParticle = std::array<G4double, ParticleCode::kNCodes>;
+
+  // One row of the event table, appended when the event finishes
+  struct EventData {
+    G4int eventID;
+    G4int subEvent;
+    G4double energyDeposit;		// Sum over all particle classes
+    EnergyByParticle energyByParticle;	// Indexed by ParticleCode
+    G4ThreeVector gunPosition;
+    long seeds[2];			// Engine seeds the event ran with
+    G4double phononSurvival;		// Prompt phonons kept (-phononBudget)
+    G4int nHits;			// Its hits follow each other in the buffer
+  };
+
+  // Digitized pulse of one event (-digitize)
+  struct PulseData {
+    G4int eventID;
+    G4int subEvent;
+    G4bool detected;
+    G4double firstTime;			// ns, -1 if not detected
+    G4int firstStrip;			// Strip of the first click, -1 if none
+    G4double firstPathLength;		// Centre of the first cell to switch
+    G4int nStrips;			// Strips that clicked
+    G4double energy;			// Weighted, eV, all hits of the event
+  };
+
+  // One strip that clicked
+  struct StripPulse {
+    G4int eventID;
+    G4int subEvent;
+    G4int strip;
+    G4double time;			// ns
+    G4double energy;			// Weighted, eV, all hits on the strip
+  };
+
+  Run();
+  virtual ~Run();
+
+  // Append the buffers of a worker run to this (master) run
+  virtual void Merge(const G4Run* aRun);
+
+  // Put hits and events in event order so output is independent of
+  // thread scheduling
+  void SortByEvent();
+
+  // Drop everything already written out
+  void ClearBuffers();
+
+  // Hits kept in memory before spilling to disk, 0 for no limit
+  void SetHitBufferSize(std::size_t bytes) {
+    maxBufferedHits = bytes / HitColumns::HitSize();
+  }
+
+  // Hits that did not fit in the buffer (-hitBufferMB)
+  G4bool HasSpilledHits() const;
+
+  // Spill the buffered hits too, so the spool holds all of them
+  void SpillHits();
+
+  // Replace hits with the next buffer's worth of whole events from the
+  // spool, in event order; false once all have been read
+  G4bool ReadSpilledHits(HitColumns& hits);
+
+  // Function to add a hit record (of the current event) to the vector
+  void AddHitRecord(G4double energyDeposit, const G4ThreeVector& position,
+                    G4double time, G4int particleType, G4double weight,
+                    G4int trackID, const MeanderPosition& where);
+
+  // Per-event accumulator (energies are weighted) for the event being processed by this thread:
+  // reset at the start of the event, appended to the event table at its end.
+  // The event ID, gun position and seeds are set before
+  // BeginOfEventAction, so BeginEvent keeps them.
+  void BeginEvent() {
+    currentEvent.energyByParticle.fill(0.);
+    if (maxBufferedHits > 0 && hitRecords.size() >= maxBufferedHits) {
+      SpillHits();
+    }
+    eventFirstHit = hitRecords.size();
+  }
+  void SetEventID(G4int eventID, G4int subEvent=0) {
+    currentEvent.eventID = eventID;
+    currentEvent.subEvent = subEvent;
+  }
+  G4int GetEventID() const { return currentEvent.eventID; }
+  G4int GetSubEvent() const { return currentEvent.subEvent; }
+  void AddEnergyDeposit(G4int particleCode, G4double energyDeposit) {
+    currentEvent.energyByParticle[particleCode] += energyDeposit;
+  }
+  void SetGunPosition(const G4ThreeVector& position) {
+    currentEvent.gunPosition = position;
+  }
+  void SetEventSeeds(const long seeds[2]) {
+    currentEvent.seeds[0] = seeds[0];
+    currentEvent.seeds[1] = seeds[1];
+  }
+  void SetPhononSurvival(G4double survival) {
+    currentEvent.phononSurvival = survival;
+  }
+  void EndEvent();
+
+  // Where the hits of the current (or just ended) event start in the
+  // buffer; an event is never split by spilling
+  std::size_t GetEventFirstHit() const { return eventFirstHit; }
+
+  // Forget the hits of the event just ended, once digitized
+  void DropEventHits();
+
+  const HitColumns& GetHitRecords() const { return hitRecords; }
+  const std::vector<EventData>& GetEventRecords() const { return eventRecords; }
+
+  // Particles reaching the chip housing in stage 1 (-writePhaseSpace)
+  void AddPhaseSpaceRecord(const PhaseSpaceFormat::Record& record) {
+    phaseSpaceRecords.push_back(record);
+  }
+  const std::vector<PhaseSpaceFormat::Record>& GetPhaseSpaceRecords() const {
+    return phaseSpaceRecords;
+  }
+
+  // Energy deposits in the lattice volumes (-writeDeposits)
+  void AddDeposit(const PhaseSpaceFormat::Deposit& deposit) {
+    deposits.push_back(deposit);
+  }
+  const std::vector<PhaseSpaceFormat::Deposit>& GetDeposits() const {
+    return deposits;
+  }
+
+  // Pulses of the events digitized so far (-digitize)
+  void AddPulse(const PulseData& pulse, const std::vector<StripPulse>& strips) {
+    pulses.push_back(pulse);
+    stripPulses.insert(stripPulses.end(), strips.begin(), strips.end());
+  }
+  const std::vector<PulseData>& GetPulses() const { return pulses; }
+  const std::vector<StripPulse>& GetStripPulses() const { return stripPulses; }
+
+  StepProfile& GetStepProfile() { return stepProfile; }
+  const RunSummary& GetSummary() const { return summary; }
+
+  // Totals over the run, unaffected by flushing (for SNSPDBench)
+  void CountStep() { ++nSteps; }
+  G4long GetNumberOfSteps() const { return nSteps; }
+  G4long GetNumberOfHits() const { return nHits; }
+
+private:
+  HitColumns hitRecords;
+  HitSpool* hitSpool;			// Hits spilled from hitRecords
+  std::size_t maxBufferedHits;		// 0 for no limit
+  std::vector<EventData> eventRecords;
+  std::vector<PhaseSpaceFormat::Record> phaseSpaceRecords;
+  std::vector<PhaseSpaceFormat::Deposit> deposits;
+  std::vector<PulseData> pulses;
+  std::vector<StripPulse> stripPulses;
+  EventData currentEvent;
+  StepProfile stepProfile;		// Kept across flushes, merged like hits
+  RunSummary summary;			// Kept across flushes
+  std::size_t eventFirstHit;		// Of the current event in hitRecords
+  G4long nSteps;
+  G4long nHits;
+};
+
+#endif	/* Run_hh */
@@ -8,6 +8,8 @@
 #include "Randomize.hh" // Custom header for random number generation
 #include "G4Args.hh" // Custom header for argument handling
 
+class Run;
+
 // Include standard C++ headers
 #include <string.h> // For string manipulation functions
 // #include "G4AnalysisManager.hh" // Class for managing analysis tools
@@ -15,6 +17,7 @@
 
 #include "G4Run.hh" // Base class for run actions
 #include "G4String.hh"
+#include "G4ThreeVector.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4SDManager.hh"
 
@@ -28,10 +31,29 @@ public:
     // Destructor
     ~RunAction();
 
+    // Each thread accumulates its hits in its own Run, merged on the master
+    virtual G4Run* GenerateRun();
+
     // Virtual methods to perform custom actions at the beginning and end of a simulation run
     virtual void BeginOfRunAction(const G4Run*);
     virtual void EndOfRunAction(const G4Run*);
 
+    // Fill the output with everything buffered in the run and clear it
+    void WriteBufferedEvents(Run*);
+
+    // Print and save the run statistics (Summary ntuple)
+    void WriteSummary(Run*);
+
+    // Print and save the stepping profile (-profile)
+    void WriteStepProfile(Run*);
+
+    // The per-hit histograms of AnalyzeProtonEvent (AnalysisTools), filled
+    // by SensitiveDetector as hits are made; energy in eV, position in um
+    // and time in ns, as in the Hits ntuple
+    void FillHitHistograms(G4int particleType, G4double energyDeposit,
+                           const G4ThreeVector& position, G4double time,
+                           G4double weight) const;
+
 private:
     // Command string, possibly for user input or configuration
     G4String command;
@@ -40,6 +62,33 @@ private:
 
     // Pointer to MyG4Args for passing arguments
     MyG4Args* PassArgs;
+
+    // Ntuple ID of the stepping profile, -1 without -profile
+    G4int fProfileNtuple;
+
+    // Ntuple IDs of the digitized pulses, -1 without -digitize
+    G4int fPulseNtuple;
+    G4int fStripPulseNtuple;
+
+    // Histogram IDs of one particle group
+    struct HitHistograms {
+        G4int eDep;
+        G4int hitXY;
+        G4int hitYZ;
+        G4int hitXZ;
+        G4int hitTime;
+    };
+    enum { kProtonHits, kPhononHits, kPhononLHits, kPhononTSHits,
+           kPhononTFHits, kNHitGroups };
+
+    // Booked on every thread in the same order; the analysis manager adds
+    // the workers' histograms to the master's when the file is written
+    void BookHitHistograms();
+    void FillHitHistograms(const HitHistograms& histograms, G4double energyDeposit,
+                           const G4ThreeVector& position, G4double time,
+                           G4double weight) const;
+
+    HitHistograms fHitHistograms[kNHitGroups];
 };
 
 #endif // RUN_HH
@@ -0,0 +1,72 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef RunSummary_hh
+#define RunSummary_hh 1
+
+// $Id$
+// File:  RunSummary.hh
+//
+// Description:	Per-run statistics kept as streaming accumulators (see
+//		StreamingStats.hh), updated once per event by Run and merged
+//		with the worker runs: energy per event and by particle
+//		class (eV), hit multiplicity, first-hit and hit times (ns),
+//		and the fraction of events with a hit.  Memory does not
+//		grow with the number of events or hits.  Hit times are
+//		weighted by the hit's track weight.
+
+#include "G4String.hh"
+#include "ParticleCode.hh"
+#include "StreamingStats.hh"
+#include "globals.hh"
+#include <array>
+#include <iosfwd>
+#include <vector>
+
+
+class RunSummary {
+public:
+  // One summarized quantity
+  struct Row {
+    G4String name;
+    const StreamingStat* stat;
+  };
+
+  // Quantiles written to the Summary ntuple and printed
+  static const std::vector<G4double>& Quantiles();
+
+  void AddEvent(G4double energy,
+		const std::array<G4double, ParticleCode::kNCodes>& energyByParticle,
+		G4int nHits, G4double firstTime) {
+    energyPerEvent.Add(energy);
+    for (G4int code=0; code<ParticleCode::kNCodes; ++code) {
+      energyByCode[code].Add(energyByParticle[code]);
+    }
+    multiplicity.Add(nHits);
+    hitEfficiency.Add(nHits > 0 ? 1. : 0.);
+    if (nHits > 0) firstHitTime.Add(firstTime);
+  }
+
+  void AddHitTime(G4double time, G4double weight) {
+    hitTime.Add(time, weight);
+  }
+
+  void Merge(const RunSummary& other);
+
+  // Everything, with particle classes that never deposited energy left out
+  std::vector<Row> GetRows() const;
+
+  void Print(std::ostream& os) const;
+
+private:
+  StreamingStat energyPerEvent;
+  std::array<StreamingStat, ParticleCode::kNCodes> energyByCode;
+  StreamingStat multiplicity;
+  StreamingStat hitEfficiency;		// Mean is the fraction with hits
+  StreamingStat firstHitTime;		// Events with hits only
+  StreamingStat hitTime;
+};
+
+#endif	/* RunSummary_hh */
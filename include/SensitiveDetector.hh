@@ -4,6 +4,14 @@
 // Include necessary Geant4 headers for sensitive detectors and analysis
 #include "G4CMPElectrodeSensitivity.hh"
 #include "G4Args.hh"
+#include "MeanderSolid.hh"
+#include <set>
+#include <utility>
+#include <vector>
+
+class G4ParticleDefinition;
+class RunAction;
+class G4VPhysicalVolume;
 
 // Declare the MySensitiveDetector class, inheriting from G4VSensitiveDetector
 class SensitiveDetector final : public G4CMPElectrodeSensitivity
@@ -13,16 +21,43 @@ public:
     SensitiveDetector(G4String name, MyG4Args*);
     // Destructor
     ~SensitiveDetector();
+
+    // Only steps ending in one of these volumes are recorded (the wire);
+    // set by DetectorConstruction whenever the geometry is (re)built.  A
+    // rebuilt wire may reuse the old one's address with a new layout, so
+    // the layout is looked up again.
+    void SetTargetVolumes(const std::set<const G4VPhysicalVolume*>& volumes) {
+        fTargetVolumes = volumes;
+        fMeanderVolume = 0;
+    }
     
 protected:
     virtual G4bool IsHit(const G4Step*, const G4TouchableHistory*) const;
     virtual G4bool ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist);
-    G4double GetEnergyDep(const G4Step* step);
+    G4double GetEnergyDep(const G4Step* step, G4bool isPhonon) const;
+
+    // ParticleCode of the track's species, by definition pointer
+    G4int Classify(const G4ParticleDefinition* particle) const;
+    G4bool IsHit(const G4Step* step, G4bool isPhonon) const;
+
+    // Strip, segment and path length of a hit, from the layout of the
+    // meander it is in (DetectorParameters if the volume is no meander)
+    MeanderPosition Locate(const G4StepPoint* point);
     
 private:
     // ProcessHits method is called for each step in the detector
 
     MyG4Args* PassArgs;
+
+    // Particle definition -> ParticleCode, phonons first since they
+    // dominate the hits; filled once in the constructor
+    std::vector<std::pair<const G4ParticleDefinition*, G4int> > fParticleCodes;
+    std::set<const G4VPhysicalVolume*> fTargetVolumes;
+    G4int fDebugLevel;  // G4CMP_DEBUG, read once
+    const RunAction* fRunAction;  // Fills the hit histograms
+    const G4VPhysicalVolume* fMeanderVolume;  // Whose layout fMeanderLayout is
+    MeanderLayout fMeanderLayout;
+
     std::ofstream primaryOutput;
     std::ofstream hitOutput;
 
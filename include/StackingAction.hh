@@ -0,0 +1,71 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef StackingAction_hh
+#define StackingAction_hh 1
+
+// $Id$
+// File:  StackingAction.hh
+//
+// Description:	G4CMP stacking with a per-event phonon budget.  The G4CMP
+//		tracks made from the event's energy deposits (prompt phonons
+//		and charge carriers) are held back until everything else in
+//		the event has been tracked.  Then each kind is thinned by
+//		Russian roulette to about -phononBudget tracks, so the
+//		survival probability follows the deposited energy.  Luke
+//		phonons appear one at a time while the charges drift; the
+//		n-th of an event survives with probability
+//		min(1, -lukeBudget/n), which bounds their number to about
+//		L*(1 + ln(N/L)).
+//
+//		Survivors' weights are divided by their survival probability
+//		(which never depends on the outcome of their own draw), so
+//		weighted hit sums, and the energy spectrum, stay unbiased.
+//		The downsampling set by /g4cmp/producePhonons and
+//		/g4cmp/sampleLuke still applies first.
+
+#include "G4CMPStackingAction.hh"
+#include "G4Args.hh"
+#include "globals.hh"
+
+class G4Track;
+
+
+class StackingAction : public G4CMPStackingAction {
+public:
+  StackingAction(MyG4Args* MainArgs);
+  virtual ~StackingAction() {;}
+
+  virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+  virtual void NewStage();
+  virtual void PrepareNewEvent();
+
+private:
+  enum PromptKind { kPhonons, kCharges, kNPromptKinds };
+
+  // Survival probability of a track, given how many of its kind compete
+  // for the budget
+  static G4double Survival(G4long budget, G4long nTracks) {
+    return (budget > 0 && nTracks > budget) ? G4double(budget)/nTracks : 1.;
+  }
+
+  // Keep the track (as keep) with probability survival, dividing its
+  // weight by it
+  G4ClassificationOfNewTrack Roulette(const G4Track* track, G4double survival,
+				      G4ClassificationOfNewTrack keep) const;
+
+  G4bool IsLukePhonon(const G4Track* track) const;
+
+  G4long phononBudget;			// Prompt tracks per kind, 0 for all
+  G4long lukeBudget;			// Luke phonons, 0 for all
+
+  G4bool promptStage;			// Prompt G4CMP tracks are held back
+  G4bool releasing;			// ReClassify() of the held tracks
+  G4long nPrompt[kNPromptKinds];
+  G4double promptSurvival[kNPromptKinds];
+  G4long nLuke;				// Luke phonons so far this event
+};
+
+#endif	/* StackingAction_hh */
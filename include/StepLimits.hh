@@ -0,0 +1,50 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef StepLimits_hh
+#define StepLimits_hh 1
+
+// $Id$
+// File:  StepLimits.hh
+//
+// Description:	Maximum step lengths by particle class and by distance from
+//		the wire plane, attached to the substrate and wire logical
+//		volumes in place of a single G4UserLimits step.  Configured
+//		with -stepLimits or /g4cmp/stepLimits as a comma-separated
+//		list of "volume:class:step_nm[:within_um]", where volume is
+//		substrate or wire and class is electron (e-/e+), muon,
+//		hadron (other charged particles), or all.  Without
+//		within_um a limit applies throughout the volume.  A track
+//		approaching a region with a finer limit is stopped at its
+//		edge, so that it cannot step over the region.
+//
+//		Only particles given a G4StepLimiter by G4StepLimiterPhysics
+//		(charged ones, by default) are limited.
+
+#include "G4UserLimits.hh"
+#include <utility>
+#include <vector>
+
+
+class StepLimits : public G4UserLimits {
+public:
+  // Keeps the entries of spec for the named volume; fatal on a bad spec
+  StepLimits(const G4String& volume, const G4String& spec);
+  virtual ~StepLimits() {;}
+
+  virtual G4double GetMaxAllowedStep(const G4Track& track);
+
+  static const G4String& DefaultSpec();
+
+private:
+  enum ParticleClass { kElectron, kMuon, kHadron, kNeutral, kNClasses };
+
+  ParticleClass Classify(const G4Track& track) const;
+
+  // (within distance, max step) for each class, by increasing distance
+  std::vector<std::pair<G4double, G4double> > limits[kNClasses];
+};
+
+#endif	/* StepLimits_hh */
@@ -0,0 +1,104 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef StepProfile_hh
+#define StepProfile_hh 1
+
+// $Id$
+// File:  StepProfile.hh
+//
+// Description:	Step counts and wall time by (physical volume, particle,
+//		process that limited the step), filled by SteppingAction
+//		when -profile is given.  Each step is charged with the time
+//		since the previous step (or the start of the event), which
+//		includes stacking its secondaries and starting new tracks.
+//
+//		Steps are keyed by pointer and only resolved to names when
+//		runs are merged or the table is written.  Process objects
+//		belong to their worker thread, so merged rows are keyed by
+//		name.
+
+#include "G4String.hh"
+#include "globals.hh"
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+class G4ParticleDefinition;
+class G4Step;
+class G4VPhysicalVolume;
+class G4VProcess;
+
+
+class StepProfile {
+public:
+  // One line of the table
+  struct Row {
+    G4String volume;
+    G4String particle;
+    G4String process;
+    G4double nSteps;			// Can exceed the range of G4int
+    G4double seconds;
+  };
+
+  StepProfile();
+
+  // Restart the clock, so time between events is not charged to a step
+  void StartClock() { lastTime = Clock::now(); }
+
+  // Charge the time since the last call to this step's key
+  void Record(const G4Step* step);
+
+  // Add the steps and times of a worker's profile
+  void Merge(const StepProfile& other);
+
+  void Clear();
+
+  // All keys by name, most expensive first
+  std::vector<Row> GetRows() const;
+
+  // Table of the most expensive maxRows keys, with totals
+  void Print(std::ostream& os, std::size_t maxRows=25) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Key {
+    const G4VPhysicalVolume* volume;
+    const G4ParticleDefinition* particle;
+    const G4VProcess* process;
+
+    G4bool operator==(const Key& rhs) const {
+      return volume == rhs.volume && particle == rhs.particle &&
+	process == rhs.process;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  struct Counts {
+    G4double nSteps;
+    G4double seconds;
+  };
+
+  using Names = std::tuple<G4String, G4String, G4String>;
+
+  static Names NamesOf(const Key& key);
+  void AddByName(const Names& names, const Counts& counts);
+
+  std::unordered_map<Key, Counts, KeyHash> byPointer;	// Filled by Record
+  std::map<Names, Counts> byName;			// Filled by Merge
+  Key lastKey;				// Consecutive steps often share a key
+  Counts* lastCounts;
+  Clock::time_point lastTime;
+};
+
+#endif	/* StepProfile_hh */
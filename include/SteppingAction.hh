@@ -10,8 +10,13 @@
 #include "G4Args.hh"
 
 #include <fstream>
+#include <set>
 
 class G4Step;
+class G4StepPoint;
+class G4VPhysicalVolume;
+class PhononImportance;
+class Run;
 
 class SteppingAction : public G4UserSteppingAction
 {
@@ -23,11 +28,22 @@ public:
   void ExportStepInformation( const G4Step * step );
   
 private:
+  // Stage 1 (-writePhaseSpace): the point where the track enters (or, for
+  // a new track, starts in) the chip housing, null otherwise
+  const G4StepPoint* GetPhaseSpacePoint(const G4Step* step);
+  void RecordPhaseSpace(const G4Step* step, const G4StepPoint* point, Run* run);
+
+  // -writeDeposits: save a step's energy deposit if it is in a lattice
+  void RecordDeposit(const G4Step* step, Run* run);
 
   //Step info output file
   std::ofstream fOutputFile;
   
   MyG4Args* PassArgs;
+  PhononImportance* fImportance;  // Null unless -phononImportance is given
+  const std::set<const G4VPhysicalVolume*>* fPhaseSpaceVolumes;  // From DetectorConstruction
+  G4VPhysicalVolume* fDepositVolume;  // Last volume checked for a lattice
+  G4bool fDepositVolumeHasLattice;
   
   
 };
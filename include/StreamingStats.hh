@@ -0,0 +1,94 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+#ifndef StreamingStats_hh
+#define StreamingStats_hh 1
+
+// $Id$
+// File:  StreamingStats.hh
+//
+// Description:	Mergeable one-pass accumulators of fixed size.  Welford
+//		keeps the (weighted) count, mean, variance and range;
+//		TDigest keeps about `compression` centroids from which any
+//		quantile can be estimated, most accurately in the tails.
+//		Both merge exactly as if all values had been added to one
+//		of them (up to the digest's own approximation), so worker
+//		threads and separate jobs can be combined.  No Geant4
+//		dependence, so the analysis tools can use them too.
+
+#include <cstddef>
+#include <vector>
+
+
+class Welford {
+public:
+  Welford() : weight(0.), mean(0.), m2(0.), min(0.), max(0.) {;}
+
+  void Add(double x, double w=1.);
+  void Merge(const Welford& other);
+
+  double GetWeight() const { return weight; }	// The count, for unit weights
+  double GetMean() const { return mean; }
+  double GetVariance() const;			// Unbiased for unit weights
+  double GetStdDev() const;
+  double GetMin() const { return min; }
+  double GetMax() const { return max; }
+
+private:
+  double weight;
+  double mean;
+  double m2;				// Weighted sum of squared deviations
+  double min, max;
+};
+
+
+// Merging t-digest (Dunning & Ertl) with the arcsine scale function
+
+class TDigest {
+public:
+  explicit TDigest(double compression=100.);
+
+  void Add(double x, double w=1.);
+  void Merge(const TDigest& other);
+
+  // Estimated q-quantile, 0 <= q <= 1; zero when empty
+  double Quantile(double q) const;
+
+  double GetWeight() const { return totalWeight + bufferWeight; }
+  std::size_t GetNumCentroids() const { Compress(); return centroids.size(); }
+
+private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  // Fold the buffer into the centroids
+  void Compress() const;
+  double ScaleK(double q) const;
+
+  double compression;
+  double min, max;
+  mutable std::vector<Centroid> centroids;	// Sorted by mean
+  mutable std::vector<Centroid> buffer;		// Unsorted new values
+  mutable double totalWeight;			// In centroids
+  mutable double bufferWeight;
+};
+
+
+// Moments and quantiles of one quantity
+
+struct StreamingStat {
+  Welford moments;
+  TDigest digest;
+
+  void Add(double x, double w=1.) { moments.Add(x, w); digest.Add(x, w); }
+  void Merge(const StreamingStat& other) {
+    moments.Merge(other.moments);
+    digest.Merge(other.digest);
+  }
+};
+
+#endif	/* StreamingStats_hh */
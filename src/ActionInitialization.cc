@@ -8,7 +8,7 @@
 #include "ActionInitialization.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "SteppingAction.hh"
-#include "G4CMPStackingAction.hh"
+#include "StackingAction.hh"
 #include "EventAction.hh"
 #include "RunAction.hh"
 
@@ -18,9 +18,13 @@ ActionInitialization::ActionInitialization(MyG4Args *MainArgs) {
 ActionInitialization::~ActionInitialization() {
 }
 
+void ActionInitialization::BuildForMaster() const {
+  SetUserAction(new RunAction(PassArgs));
+}
+
 void ActionInitialization::Build() const {
   SetUserAction(new PrimaryGeneratorAction(PassArgs));
-  SetUserAction(new G4CMPStackingAction);
+  SetUserAction(new StackingAction(PassArgs));
   SetUserAction(new SteppingAction(PassArgs));
   
   RunAction* runAction = new RunAction(PassArgs);
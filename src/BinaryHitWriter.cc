@@ -0,0 +1,213 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  BinaryHitWriter.cc
+//
+// Description:	Singleton writer for the columnar binary hit file (see
+//		HitFileFormat.hh), selected with -outputFormat binary|both.
+//		The master opens and closes the file; any thread may append
+//		a block of hits, one whole flush at a time.  The event index
+//		is collected as blocks are appended and written on close.
+
+#include "BinaryHitWriter.hh"
+#include "HitFileFormat.hh"
+#include "G4AutoLock.hh"
+#include "G4SystemOfUnits.hh"
+#include <cstring>
+
+using namespace HitFileFormat;
+
+namespace {
+  // Column table written to every file; the block payload follows it
+  const ColumnInfo hitColumns[] = {
+    { "EventID",       kInt32   },
+    { "EnergyDeposit", kFloat32 },
+    { "PositionX",     kFloat32 },
+    { "PositionY",     kFloat32 },
+    { "PositionZ",     kFloat32 },
+    { "Time",          kFloat32 },
+    { "ParticleType",  kUInt8   },
+    { "Weight",        kFloat32 },
+    { "SubEvent",      kInt32   },
+    { "TrackID",       kInt32   },
+    { "Strip",         kInt32   },
+    { "Segment",       kInt32   },
+    { "PathLength",    kFloat32 },
+  };
+  const std::uint32_t nHitColumns = sizeof(hitColumns)/sizeof(ColumnInfo);
+
+  // A block column from a column of the hit store, as one unit-stride
+  // loop the compiler vectorizes (through raw pointers, or a uint8_t
+  // block could alias the vector itself)
+  template <class To, class From>
+  void CopyColumn(char* block, const std::vector<From>& column) {
+    To* to = reinterpret_cast<To*>(block);
+    const From* from = column.data();
+    const std::size_t n = column.size();
+    for (std::size_t i=0; i<n; ++i) to[i] = To(from[i]);
+  }
+
+  void ScaleColumn(char* block, const std::vector<G4double>& column,
+		   G4double scale) {
+    float* to = reinterpret_cast<float*>(block);
+    const G4double* from = column.data();
+    const std::size_t n = column.size();
+    for (std::size_t i=0; i<n; ++i) to[i] = float(from[i] * scale);
+  }
+}
+
+
+// Constructor and Singleton Initializer
+
+BinaryHitWriter* BinaryHitWriter::theInstance = 0;
+
+BinaryHitWriter* BinaryHitWriter::Instance() {
+  if (!theInstance) theInstance = new BinaryHitWriter;
+  return theInstance;
+}
+
+BinaryHitWriter::BinaryHitWriter()
+  : file(0), fileMutex(G4MUTEX_INITIALIZER), nBlocks(0), nHits(0) {;}
+
+BinaryHitWriter::~BinaryHitWriter() {
+  Close();
+}
+
+
+void BinaryHitWriter::Open(const G4String& name, G4int firstEvent,
+			   G4int nEvents) {
+  Close();
+
+  file = std::fopen(name.c_str(), "w+b");	// Close() rereads the header
+  if (!file) {
+    G4Exception("BinaryHitWriter::Open", "SNSPDHitFile001", FatalException,
+		("Cannot open " + name + " for writing").c_str());
+    return;
+  }
+
+  fileName = name;
+  nBlocks = 0;
+  nHits = 0;
+  eventIndex.clear();
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byteOrder = kByteOrderMark;
+  header.nColumns = nHitColumns;
+  header.firstEvent = firstEvent;
+  header.nEvents = nEvents;
+
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fwrite(hitColumns, sizeof(ColumnInfo), nHitColumns, file);
+  std::fflush(file);
+
+  G4cout << "### Writing binary hits to " << fileName << G4endl;
+}
+
+// Append the event index, then fill in the block and hit counts so
+// readers can cross-check them
+
+void BinaryHitWriter::Close() {
+  if (!file) return;
+
+  IndexHeader indexHeader = { kIndexMagic, 0, eventIndex.size() };
+  std::fseek(file, 0, SEEK_END);
+  std::fwrite(&indexHeader, sizeof(indexHeader), 1, file);
+  std::fwrite(eventIndex.data(), sizeof(IndexEntry), eventIndex.size(), file);
+
+  FileHeader header;
+  std::fseek(file, 0, SEEK_SET);
+  if (std::fread(&header, sizeof(header), 1, file) != 1) {
+    std::memset(&header, 0, sizeof(header));
+  }
+  header.nBlocks = nBlocks;
+  header.nHits = nHits;
+  std::fseek(file, 0, SEEK_SET);
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fclose(file);
+  file = 0;
+
+  G4cout << "### Wrote " << nHits << " hits of " << eventIndex.size()
+	 << " events in " << nBlocks << " blocks to " << fileName << G4endl;
+  eventIndex.clear();
+}
+
+
+// The block and its index entries are assembled outside the lock, a
+// column at a time; only the append, which fixes their positions in the
+// file, is serialized
+
+std::uint64_t BinaryHitWriter::WriteBlock(const HitColumns& hits) {
+  if (!file || hits.empty()) {
+    G4AutoLock lock(&fileMutex);	// Other workers may be appending
+    return nHits;
+  }
+
+  const std::size_t n = hits.size();
+
+  std::size_t payload = 0;
+  for (const ColumnInfo& column : hitColumns) {
+    payload += Padded(n * ElementSize(column.type));
+  }
+
+  std::vector<char> buffer(sizeof(BlockHeader) + payload, 0);
+
+  BlockHeader* header = reinterpret_cast<BlockHeader*>(buffer.data());
+  header->magic = kBlockMagic;
+  header->nHits = n;
+  header->blockBytes = buffer.size();
+
+  char* column = buffer.data() + sizeof(BlockHeader);
+  auto nextColumn = [&column, n](std::size_t elementSize) {
+    char* start = column;
+    column += Padded(n * elementSize);
+    return start;
+  };
+
+  // Energy is already in eV and time in ns
+  const G4double perUm = 1./um;
+  CopyColumn<std::int32_t>(nextColumn(4), hits.eventID);
+  CopyColumn<float>(nextColumn(4), hits.energyDeposit);
+  ScaleColumn(nextColumn(4), hits.x, perUm);
+  ScaleColumn(nextColumn(4), hits.y, perUm);
+  ScaleColumn(nextColumn(4), hits.z, perUm);
+  CopyColumn<float>(nextColumn(4), hits.time);
+  CopyColumn<std::uint8_t>(nextColumn(1), hits.particleType);
+  CopyColumn<float>(nextColumn(4), hits.weight);
+  CopyColumn<std::int32_t>(nextColumn(4), hits.subEvent);
+  CopyColumn<std::int32_t>(nextColumn(4), hits.trackID);
+  CopyColumn<std::int32_t>(nextColumn(4), hits.strip);
+  CopyColumn<std::int32_t>(nextColumn(4), hits.segment);
+  ScaleColumn(nextColumn(4), hits.pathLength, perUm);
+
+  // The hits of an event follow each other (see Run::SortByEvent);
+  // firstHit is relative to the block until the block has its place
+  const std::vector<G4int>& eventID = hits.eventID;
+  const std::vector<G4int>& subEvent = hits.subEvent;
+  std::vector<IndexEntry> entries;
+  for (std::size_t i=0; i<n; ++i) {
+    if (i == 0 || eventID[i] != eventID[i-1] || subEvent[i] != subEvent[i-1]) {
+      entries.push_back({ eventID[i], subEvent[i], i, 0, 0 });
+    }
+    ++entries.back().nHits;
+  }
+
+  G4AutoLock lock(&fileMutex);
+  std::fwrite(buffer.data(), buffer.size(), 1, file);
+  std::fflush(file);		// Keep every finished block on disk
+
+  const std::uint64_t firstHit = nHits;
+  for (IndexEntry& entry : entries) {
+    entry.firstHit += firstHit;
+    entry.block = nBlocks;
+    eventIndex.push_back(entry);
+  }
+  ++nBlocks;
+  nHits += n;
+  return firstHit;
+}
@@ -9,13 +9,23 @@
 // Description:	Singleton container class for user configuration of G4CMP
 //		phonon example. Looks for environment variables	at
 //		initialization to set default values; active values may be
-//		changed via macro commands (see ConfigMessenger).
+//		changed via macro commands (see ConfigMessenger).  The
+//		meander dimensions and the absorption and reflection
+//		probabilities of the border surfaces may be changed too,
+//		and RunScan() runs a list of such configurations in one
+//		job, each into its own output.
 //
 // 20170816  M. Kelsey -- Extract hit filename from G4CMPConfigManager.
 
 #include "ConfigManager.hh"
 #include "ConfigMessenger.hh"
+#include "StepLimits.hh"
 #include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4UIcommandStatus.hh"
+#include "G4UImanager.hh"
+#include <fstream>
+#include <sstream>
 #include <stdlib.h>
 
 
@@ -31,6 +41,8 @@ ConfigManager* ConfigManager::Instance() {
 ConfigManager::ConfigManager()
   : Hit_file(getenv("G4CMP_HIT_FILE")?getenv("G4CMP_HIT_FILE"):"_hits.txt"),
     Primary_file("_primary.txt"),
+    StepLimits_spec(getenv("G4CMP_STEP_LIMITS")?getenv("G4CMP_STEP_LIMITS"):StepLimits::DefaultSpec()),
+    Meander_layout(MeanderLayout::FromDetectorParameters()),
     messenger(new ConfigMessenger(this)) {;}
 
 ConfigManager::~ConfigManager() {
@@ -38,8 +50,89 @@ ConfigManager::~ConfigManager() {
 }
 
 
-// Trigger rebuild of geometry if parameters change
+// Trigger rebuild of geometry if parameters change; before initialization
+// the geometry is still to be built with the new values
 
 void ConfigManager::UpdateGeometry() {
+  if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_PreInit)
+    return;
   G4RunManager::GetRunManager()->ReinitializeGeometry(true);
 }
+
+
+// Only the surfaces named in a command are overridden.  As in G4CMP,
+// reflProb is the probability to reflect what is not absorbed.
+
+void ConfigManager::SetSurface(SurfaceProbabilities& table,
+			       const G4String& spec) {
+  std::istringstream words(spec);
+  G4String name;
+  G4double absProb = -1., reflProb = -1.;
+  words >> name >> absProb >> reflProb;
+  if (!words || absProb < 0. || absProb > 1. || reflProb < 0. ||
+      reflProb > 1.) {
+    G4Exception("ConfigManager::SetSurface", "SNSPDConfig001", JustWarning,
+		("Ignoring surface '" + spec + "', expected name absProb"
+		 " reflProb, both within [0,1]").c_str());
+    return;
+  }
+
+  table[name] = std::make_pair(absProb, reflProb);
+  UpdateGeometry();
+}
+
+void ConfigManager::ResetParameters() {
+  ConfigManager* theManager = Instance();
+  theManager->Meander_layout = MeanderLayout::FromDetectorParameters();
+  theManager->PhononSurface_probs.clear();
+  theManager->ChargeSurface_probs.clear();
+  UpdateGeometry();
+}
+
+
+// The physics tables are built once, before the first configuration; only
+// the geometry (and with it the surfaces) is rebuilt for each of them
+
+void ConfigManager::RunScan(const G4String& fileName, G4int nEvents) {
+  std::ifstream scanFile(fileName);
+  if (!scanFile) {
+    G4Exception("ConfigManager::RunScan", "SNSPDConfig002", JustWarning,
+		("Cannot open scan file " + fileName).c_str());
+    return;
+  }
+
+  G4UImanager* UImanager = G4UImanager::GetUIpointer();
+  std::string line;
+  while (std::getline(scanFile, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream configuration(line);
+    std::string tag;
+    if (!(configuration >> tag)) continue;
+
+    ResetParameters();
+
+    G4bool applied = true;
+    std::string command;
+    while (applied && std::getline(configuration, command, ';')) {
+      const std::size_t first = command.find_first_not_of(" \t");
+      if (first == std::string::npos) continue;
+      const std::size_t last = command.find_last_not_of(" \t");
+      command = command.substr(first, last - first + 1);
+      applied = (UImanager->ApplyCommand(command) == fCommandSucceeded);
+    }
+    if (!applied) {
+      G4Exception("ConfigManager::RunScan", "SNSPDConfig003", JustWarning,
+		  ("Skipping configuration " + tag + ", '" + command
+		   + "' failed").c_str());
+      continue;
+    }
+
+    G4cout << "### Scan configuration " << tag << ": " << nEvents
+	   << " events" << G4endl;
+    SetOutputTag(tag);
+    G4RunManager::GetRunManager()->BeamOn(nEvents);
+  }
+
+  ResetParameters();
+  SetOutputTag("");
+}
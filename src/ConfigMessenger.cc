@@ -7,27 +7,101 @@
 // File:  ConfigMessenger.cc
 //
 // Description:	Macro command defitions to set user configuration in
-//		ConfigManager.
+//		ConfigManager.  Meander dimensions and surface probabilities
+//		rebuild the geometry before the next run; /g4cmp/scan runs
+//		a list of configurations of them.
 //
 // 20170816  Michael Kelsey
 
 #include "ConfigMessenger.hh"
 #include "ConfigManager.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIparameter.hh"
+#include <sstream>
+#include <vector>
 
 
 // Constructor and destructor
 
 ConfigMessenger::ConfigMessenger(ConfigManager* mgr)
   : G4UImessenger("/g4cmp/", "User configuration for G4CMP phonon example"),
-    theManager(mgr), hitsCmd(0) {
+    theManager(mgr), hitsCmd(0), stepLimitsCmd(0), stripLengthCmd(0),
+    stripWidthCmd(0), stripSpacingCmd(0), filmThicknessCmd(0), nStripsCmd(0),
+    phononSurfaceCmd(0), chargeSurfaceCmd(0), resetCmd(0), outputTagCmd(0),
+    scanCmd(0) {
   hitsCmd = CreateCommand<G4UIcmdWithAString>("HitsFile",
 			      "Set filename for output of phonon hit locations");
+  stepLimitsCmd = CreateCommand<G4UIcmdWithAString>("stepLimits",
+	      "Set step limits as volume:class:step_nm[:within_um],...");
+
+  stripLengthCmd = CreateCommand<G4UIcmdWithADoubleAndUnit>("stripLength",
+				    "Set the length of the meander strips");
+  stripWidthCmd = CreateCommand<G4UIcmdWithADoubleAndUnit>("stripWidth",
+				    "Set the width of the meander strips");
+  stripSpacingCmd = CreateCommand<G4UIcmdWithADoubleAndUnit>("stripSpacing",
+			    "Set the gap between neighbouring meander strips");
+  filmThicknessCmd = CreateCommand<G4UIcmdWithADoubleAndUnit>("filmThickness",
+				    "Set the thickness of the meander film");
+  for (G4UIcmdWithADoubleAndUnit* cmd : { stripLengthCmd, stripWidthCmd,
+					   stripSpacingCmd, filmThicknessCmd }) {
+    cmd->SetUnitCategory("Length");
+    cmd->SetDefaultUnit("um");
+    cmd->SetRange("value>0");
+  }
+  nStripsCmd = CreateCommand<G4UIcmdWithAnInteger>("nStrips",
+				    "Set the number of meander strips");
+  nStripsCmd->SetRange("value>0");
+
+  phononSurfaceCmd = CreateCommand<G4UIcmdWithAString>("phononSurface",
+	      "Set phonon absorption and reflection of a border surface as"
+	      " name absProb reflProb, e.g. SiO2WSi 0.1 1.0 (reflection of"
+	      " what is not absorbed)");
+  chargeSurfaceCmd = CreateCommand<G4UIcmdWithAString>("chargeSurface",
+	      "Set charge absorption and reflection of a border surface as"
+	      " name absProb reflProb");
+  resetCmd = CreateCommand<G4UIcmdWithoutParameter>("resetParameters",
+		    "Restore the built-in meander dimensions and surfaces");
+  outputTagCmd = CreateCommand<G4UIcmdWithAString>("outputTag",
+		    "Append _tag to the names of the next runs' output files");
+  outputTagCmd->SetParameterName("tag", true);
+  outputTagCmd->SetDefaultValue("");
+
+  scanCmd = CreateCommand<G4UIcommand>("scan",
+	      "Run events for every configuration in a file, one per line:"
+	      " output tag, then macro commands separated by ';'");
+  scanCmd->SetParameter(new G4UIparameter("file", 's', false));
+  G4UIparameter* eventsParam = new G4UIparameter("events", 'i', false);
+  eventsParam->SetParameterRange("events>0");
+  scanCmd->SetParameter(eventsParam);
+
+  // The geometry and the configuration are the master's; the workers
+  // must not replay these at their next run
+  const std::vector<G4UIcommand*> masterOnly = {
+    stripLengthCmd, stripWidthCmd, stripSpacingCmd, filmThicknessCmd,
+    nStripsCmd, phononSurfaceCmd, chargeSurfaceCmd, resetCmd, outputTagCmd,
+    scanCmd };
+  for (G4UIcommand* cmd : masterOnly) {
+    cmd->SetToBeBroadcasted(false);
+  }
 }
 
 
 ConfigMessenger::~ConfigMessenger() {
   delete hitsCmd; hitsCmd=0;
+  delete stepLimitsCmd; stepLimitsCmd=0;
+  delete stripLengthCmd; stripLengthCmd=0;
+  delete stripWidthCmd; stripWidthCmd=0;
+  delete stripSpacingCmd; stripSpacingCmd=0;
+  delete filmThicknessCmd; filmThicknessCmd=0;
+  delete nStripsCmd; nStripsCmd=0;
+  delete phononSurfaceCmd; phononSurfaceCmd=0;
+  delete chargeSurfaceCmd; chargeSurfaceCmd=0;
+  delete resetCmd; resetCmd=0;
+  delete outputTagCmd; outputTagCmd=0;
+  delete scanCmd; scanCmd=0;
 }
 
 
@@ -35,4 +109,33 @@ ConfigMessenger::~ConfigMessenger() {
 
 void ConfigMessenger::SetNewValue(G4UIcommand* cmd, G4String value) {
   if (cmd == hitsCmd) theManager->SetHitOutput(value);
+  if (cmd == stepLimitsCmd) theManager->SetStepLimits(value);
+
+  if (cmd == stripLengthCmd || cmd == stripWidthCmd ||
+      cmd == stripSpacingCmd || cmd == filmThicknessCmd || cmd == nStripsCmd) {
+    MeanderLayout layout = theManager->GetMeanderLayout();
+    if (cmd == stripLengthCmd)
+      layout.stripLength = stripLengthCmd->GetNewDoubleValue(value);
+    if (cmd == stripWidthCmd)
+      layout.stripWidth = stripWidthCmd->GetNewDoubleValue(value);
+    if (cmd == stripSpacingCmd)
+      layout.stripSpacing = stripSpacingCmd->GetNewDoubleValue(value);
+    if (cmd == filmThicknessCmd)
+      layout.filmThickness = filmThicknessCmd->GetNewDoubleValue(value);
+    if (cmd == nStripsCmd) layout.nStrips = nStripsCmd->GetNewIntValue(value);
+    theManager->SetMeanderLayout(layout);
+  }
+
+  if (cmd == phononSurfaceCmd) theManager->SetPhononSurface(value);
+  if (cmd == chargeSurfaceCmd) theManager->SetChargeSurface(value);
+  if (cmd == resetCmd) theManager->ResetParameters();
+  if (cmd == outputTagCmd) theManager->SetOutputTag(value);
+
+  if (cmd == scanCmd) {
+    std::istringstream words(value);
+    G4String fileName;
+    G4int nEvents = 0;
+    words >> fileName >> nEvents;
+    theManager->RunScan(fileName, nEvents);
+  }
 }
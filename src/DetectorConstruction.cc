@@ -13,8 +13,11 @@
 // 20220809  [ For M. Hui ] -- Add frequency dependent surface properties.
 
 #include "DetectorConstruction.hh"
+#include "ConfigManager.hh"
 #include "DetectorParameters.hh"
+#include "MeanderSolid.hh"
 #include "SensitiveDetector.hh"
+#include "StepLimits.hh"
 #include "G4CMPPhononElectrode.hh"
 #include "G4CMPElectrodeSensitivity.hh"
 #include "G4CMPLogicalBorderSurface.hh"
@@ -49,7 +52,8 @@ using namespace DetectorParameters;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
 
-DetectorConstruction::DetectorConstruction(MyG4Args* MainArgs){
+DetectorConstruction::DetectorConstruction(MyG4Args* MainArgs)
+  : fWireLogical(0), fSubstrateLogical(0), fConstructed(false) {
   PassArgs = MainArgs;
 }
 
@@ -76,7 +80,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     G4CMPLogicalBorderSurface::CleanSurfaceTable();
   }
 
-  DefineMaterials();
+  // Materials are kept across rebuilds, so the physics tables are too
+  if (!fConstructed) DefineMaterials();
   SetupGeometry();
   fConstructed = true;
 
@@ -223,46 +228,46 @@ void DetectorConstruction::SetupGeometry()
   if( !fConstructed ){
     // Substrate to copper housing interface
     //   -> https://arxiv.org/pdf/2404.04423
-    fSiCuInterface = new G4CMPSurfaceProperty("SiCuInterface",
+    fSiCuInterface = DefineSurface("SiCu", "SiCuInterface",
         1.0, 0.0, 0.0, 0.0,
         0.1, 0.0, 0.0, 0.0 );
-    fCuSiInterface = new G4CMPSurfaceProperty("SiCuInterface",
+    fCuSiInterface = DefineSurface("CuSi", "SiCuInterface",
         1.0, 0.0, 0.0, 0.0,
         0.1, 1.0, 0.0, 0.0 );
     // Si substrate to SiO2 layer interface
     //   -> https://link.aps.org/accepted/10.1103/PhysRevB.97.195308
     //   -> https://qtts.engr.wisc.edu/wp-content/uploads/sites/1194/2020/08/RamayyaJAP104.pdf
-    fSiSiO2Interface = new G4CMPSurfaceProperty("SiSiO2Interface",
+    fSiSiO2Interface = DefineSurface("SiSiO2", "SiSiO2Interface",
         1.0, 0.0, 0.0, 0.0,
         1.0, 0.5, 0.0, 0.0);
-    fSiO2SiInterface = new G4CMPSurfaceProperty("SiSiO2Interface",
+    fSiO2SiInterface = DefineSurface("SiO2Si", "SiSiO2Interface",
         1.0, 0.0, 0.0, 0.0,
         1.0, 0.5, 0.0, 0.0);
     // SiO2 substrate to SiO2 top layer interface
     //   -> 
-    fSiO2SiO2Interface = new G4CMPSurfaceProperty("SiO2SiO2Interface",
+    fSiO2SiO2Interface = DefineSurface("SiO2SiO2", "SiO2SiO2Interface",
         1.0, 0.0, 0.0, 0.0,
         1.0, 0.5, 0.0, 0.0);
     // SiO2 layer to Amorphous Silicon (non-superconducting cap) interface
     //   -> 
-    fSiO2aSiInterface = new G4CMPSurfaceProperty("SiO2aSiInterface",
+    fSiO2aSiInterface = DefineSurface("SiO2aSi", "SiO2aSiInterface",
         1.0, 0.0, 0.0, 0.0,
         1.0, 1.0, 0.0, 0.0 );
-    faSiSiO2Interface = new G4CMPSurfaceProperty("SiO2aSiInterface",
+    faSiSiO2Interface = DefineSurface("aSiSiO2", "SiO2aSiInterface",
         1.0, 0.0, 0.0, 0.0,
         1.0, 1.0, 0.0, 0.0 );
     // SiO2 layer to Tungsten Silicide (superconducting wire) interface
     //   -> 
-    fSiO2WSiInterface = new G4CMPSurfaceProperty("SiO2WSiInterface",
+    fSiO2WSiInterface = DefineSurface("SiO2WSi", "SiO2WSiInterface",
         1.0, 0.0, 0.0, 0.0,
         0.1, 1.0, 0.0, 0.0 );
     // aSi layer to WSi (interface between superconducting wire and non-superconducting cap) interface
     //   -> 
-    faSiWSiInterface = new G4CMPSurfaceProperty("aSiWSiInterface",
+    faSiWSiInterface = DefineSurface("aSiWSi", "aSiWSiInterface",
         1.0, 0.0, 0.0, 0.0,
         0.1, 1.0, 0.0, 0.0 );
     // SiO2 layer to vacuum interface 
-    fSiO2VacuumInterface = new G4CMPSurfaceProperty("SiO2VacuumInterface",
+    fSiO2VacuumInterface = DefineSurface("SiO2Vacuum", "SiO2VacuumInterface",
         0.0, 1.0, 0.0, 0.0,
         0.0, 1.0, 0.0, 0.0 );
 
@@ -300,6 +305,7 @@ void DetectorConstruction::SetupGeometry()
     AttachPhononSensor(fSiO2WSiInterface);
     AttachPhononSensor(faSiWSiInterface);
   }
+  ApplySurfaceSettings();
 
 
 
@@ -410,11 +416,9 @@ void DetectorConstruction::SetupGeometry()
 
 
   //----------------------------------------------------------------
-  //Max allowed step-size in substrate
-  G4UserLimits* substrateUserLimits = new G4UserLimits();
-  substrateUserLimits->SetMaxAllowedStep(50. * CLHEP::nm);
-  G4UserLimits* wireUserLimits = new G4UserLimits();
-	wireUserLimits->SetMaxAllowedStep(0.05 * CLHEP::nm);
+  //Max allowed step-size in substrate and wire, by particle class and region
+  G4UserLimits* substrateUserLimits = new StepLimits("substrate", ConfigManager::GetStepLimits());
+  G4UserLimits* wireUserLimits = new StepLimits("wire", ConfigManager::GetStepLimits());
 
 
 
@@ -479,48 +483,31 @@ void DetectorConstruction::SetupGeometry()
   //-------------------------------------------------------------------------------------------------------------------
   //Finally, setup the nanowire strips and establish a sensitivity object
 
-  G4MultiUnion* solid_WSiWire = new G4MultiUnion("solid_WSiWire");
-	
-	for (G4int i = 0; i < dp_numStrips; i++) {
-		// Position along y for each strip, considering the thickness and the spacing
-		G4double strip_y_pos = -(dp_stripDimY / 2) + i * (dp_stripThickness + dp_stripSpacing);
-    G4double wrap_y_pos = strip_y_pos + (dp_stripThickness / 2) + (dp_stripSpacing / 2);
-    // G4cout<< " ### wire " << i << ", y_pos = " << strip_y_pos <<G4endl;
-
-    G4double startAngle = 0.*CLHEP::deg;
-    G4double endAngle = 180.*CLHEP::deg;
-    G4double xRot, yRot, zRot, wrapPosX;
-    if (i % 2 == 0){
-      xRot = 0.*CLHEP::deg;
-      yRot = 0.*CLHEP::deg;
-      zRot = 90.*CLHEP::deg;
-      wrapPosX = dp_stripDimX / 2;
-    }
-    else{
-      xRot = 0.*CLHEP::deg;
-      yRot = 0.*CLHEP::deg;
-      zRot = 270.*CLHEP::deg;
-      wrapPosX = -dp_stripDimX / 2;
-    }
-
-    G4bool last_wire = false;
-    if (i + 1 == dp_numStrips){
-      last_wire = true;
-    }
-
-		// Create a strip solid with specified dimensions
-		G4Box* solid_WSiStrip = new G4Box("solid_strip_" + std::to_string(i), dp_stripDimX / 2, dp_stripThickness / 2, dp_stripDimZ / 2);
-    G4Transform3D tr_WSiStrip = G4Transform3D(G4RotationMatrix(0, 0, 0), G4ThreeVector(0, strip_y_pos, -(dp_SisubstrateDimZ+dp_SiO2substrateDimZ-dp_SiO2toplayerDimZ)/2-dp_stripDimZ/2));
-    solid_WSiWire->AddNode(*solid_WSiStrip, tr_WSiStrip);
-
-    if (!last_wire){
-      G4Tubs* solid_WSiWrap = new G4Tubs("solid_strip_" + std::to_string(i), dp_stripWrapInnerRadius, dp_stripWrapOuterRadius, dp_stripDimZ / 2, startAngle, endAngle);
-      G4Transform3D tr_WSiWrap = G4Transform3D(G4RotationMatrix(xRot, yRot, zRot), G4ThreeVector(wrapPosX, wrap_y_pos, -(dp_SisubstrateDimZ+dp_SiO2substrateDimZ-dp_SiO2toplayerDimZ)/2-dp_stripDimZ/2));
-      solid_WSiWire->AddNode(*solid_WSiWrap, tr_WSiWrap);
-	  }
+  // The meander is built around its own centre; see MeanderSolid::BuildMultiUnion
+  // for the equivalent union of one G4Box per strip and one G4Tubs per wrap
+  const MeanderLayout& wireLayout = ConfigManager::GetMeanderLayout();
+  MeanderSolid* solid_WSiWire = new MeanderSolid("solid_WSiWire", wireLayout);
+  G4double wireCenterZ = -(dp_SisubstrateDimZ+dp_SiO2substrateDimZ-dp_SiO2toplayerDimZ)/2-wireLayout.filmThickness/2;
+
+  // Dimensions set by macro (/g4cmp/stripLength etc.) must stay on the chip
+  G4ThreeVector wireMin, wireMax;
+  solid_WSiWire->BoundingLimits(wireMin, wireMax);
+  wireMin.setZ(wireMin.z() + wireCenterZ);
+  wireMax.setZ(wireMax.z() + wireCenterZ);
+  const G4ThreeVector substrateHalf(solid_Sisubstrate->GetXHalfLength(),
+				    solid_Sisubstrate->GetYHalfLength(),
+				    solid_Sisubstrate->GetZHalfLength());
+  G4bool wireFits = true;
+  for (G4int i = 0; i < 3; ++i) {
+    wireFits &= (wireMin[i] >= -substrateHalf[i] &&
+		 wireMax[i] <= substrateHalf[i]);
+  }
+  if (!wireFits) {
+    G4Exception("DetectorConstruction::SetupGeometry", "SNSPDGeometry002",
+		FatalException, "The meander does not fit on the substrate,"
+		" check /g4cmp/stripLength, stripWidth, stripSpacing,"
+		" filmThickness and nStrips");
   }
-
-  solid_WSiWire->Voxelize();
 
   G4LogicalVolume* logic_WSiWire = new G4LogicalVolume(solid_WSiWire, fWSi, "logic_WSiWire");
 
@@ -532,7 +519,7 @@ void DetectorConstruction::SetupGeometry()
 
   G4VPhysicalVolume* phys_WSiWire = new G4PVPlacement(
 		0,
-		G4ThreeVector(0., 0., 0.),
+		G4ThreeVector(0., 0., wireCenterZ),
 		logic_WSiWire,
 		"phys_WSiWire",
 		logic_Sisubstrate,
@@ -550,16 +537,17 @@ void DetectorConstruction::SetupGeometry()
   //Set up border surfaces
   G4CMPLogicalBorderSurface* border_SiO2substrate_WSiWire = new G4CMPLogicalBorderSurface("border_SiO2substrate_WSiStrip", phys_Sisubstrate, phys_WSiWire, fSiO2WSiInterface);
 
-  //Set up sensitive detector
-  //  -> Make EVERYTHING sensitive detector to ensure hits get registered, and then filter 
-  //       out only hits that occur near the SNSPD wire
-  G4SDManager* SDman = G4SDManager::GetSDMpointer();
-  fSuperconductorSensitivity = new SensitiveDetector("SensitiveDetector", PassArgs);
-  SDman->AddNewDetector(fSuperconductorSensitivity);
-  // SNSPD wire
-  logic_WSiWire->SetSensitiveDetector(fSuperconductorSensitivity);
-  // SNSPD SiO2 substrate
-  logic_Sisubstrate->SetSensitiveDetector(fSuperconductorSensitivity);
+  //Sensitive detector is attached per thread in ConstructSDandField()
+  fWireLogical = logic_WSiWire;
+  fSubstrateLogical = logic_Sisubstrate;
+  fTargetVolumes.clear();
+  fTargetVolumes.insert(phys_WSiWire);
+
+  // Everything upstream of these is cached by a stage-1 run
+  fPhaseSpaceVolumes.clear();
+  fPhaseSpaceVolumes.insert(physCu1);
+  fPhaseSpaceVolumes.insert(physCu2);
+  fPhaseSpaceVolumes.insert(phys_Sisubstrate);
 
 
 
@@ -852,6 +840,29 @@ void DetectorConstruction::SetupGeometry()
 }
 
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+// Called on every worker thread (and again after a geometry rebuild), since
+// sensitive detectors are thread-local objects
+
+void DetectorConstruction::ConstructSDandField()
+{
+  //Set up sensitive detector
+  //  -> Make EVERYTHING sensitive detector to ensure hits get registered, and then filter 
+  //       out only hits that occur near the SNSPD wire
+  G4SDManager* SDman = G4SDManager::GetSDMpointer();
+  G4VSensitiveDetector* sensitivity = SDman->FindSensitiveDetector("SensitiveDetector", false);
+  if (!sensitivity) {
+    sensitivity = new SensitiveDetector("SensitiveDetector", PassArgs);
+    SDman->AddNewDetector(sensitivity);
+  }
+  // The wire's physical volume changes whenever the geometry is rebuilt
+  static_cast<SensitiveDetector*>(sensitivity)->SetTargetVolumes(fTargetVolumes);
+  // SNSPD wire
+  SetSensitiveDetector(fWireLogical, sensitivity);
+  // SNSPD SiO2 substrate
+  SetSensitiveDetector(fSubstrateLogical, sensitivity);
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
 // Set up a phonon sensor for this surface property object. I'm pretty sure that this
 // phonon sensor doesn't get stapled to individual geometrical objects, but rather gets
@@ -878,3 +889,64 @@ void DetectorConstruction::AttachPhononSensor(G4CMPSurfaceProperty * surfProp)
   surfProp->SetPhononElectrode(new G4CMPPhononElectrode);
   
 }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+
+G4CMPSurfaceProperty*
+DetectorConstruction::DefineSurface(const G4String& key, const G4String& name,
+				    G4double qAbsProb, G4double qReflProb,
+				    G4double eMinK, G4double hMinK,
+				    G4double pAbsProb, G4double pReflProb,
+				    G4double pSpecProb, G4double pMinK) {
+  G4CMPSurfaceProperty* surfProp =
+    new G4CMPSurfaceProperty(name, qAbsProb, qReflProb, eMinK, hMinK,
+			     pAbsProb, pReflProb, pSpecProb, pMinK);
+  fSurfaces[key] = { surfProp, qAbsProb, qReflProb, eMinK, hMinK,
+		     pAbsProb, pReflProb, pSpecProb, pMinK };
+  return surfProp;
+}
+
+// The surface properties outlive the geometry; on a rebuild they are
+// refilled in place rather than redefined
+
+void DetectorConstruction::ApplySurfaceSettings()
+{
+  const ConfigManager::SurfaceProbabilities& phonon =
+    ConfigManager::GetPhononSurfaces();
+  const ConfigManager::SurfaceProbabilities& charge =
+    ConfigManager::GetChargeSurfaces();
+
+  for (const auto& surface : fSurfaces) {
+    const SurfaceDefinition& def = surface.second;
+
+    G4double pAbsProb = def.pAbsProb, pReflProb = def.pReflProb;
+    auto probs = phonon.find(surface.first);
+    if (probs != phonon.end()) {
+      pAbsProb = probs->second.first;
+      pReflProb = probs->second.second;
+    }
+    def.property->FillPhononMaterialPropertiesTable(pAbsProb, pReflProb,
+						    def.pSpecProb, def.pMinK);
+
+    G4double qAbsProb = def.qAbsProb, qReflProb = def.qReflProb;
+    probs = charge.find(surface.first);
+    if (probs != charge.end()) {
+      qAbsProb = probs->second.first;
+      qReflProb = probs->second.second;
+    }
+    def.property->FillChargeMaterialPropertiesTable(qAbsProb, qReflProb,
+						    def.eMinK, def.hMinK);
+  }
+
+  for (const auto* table : { &phonon, &charge }) {
+    for (const auto& probs : *table) {
+      if (fSurfaces.count(probs.first)) continue;
+      G4String known;
+      for (const auto& surface : fSurfaces) known += " " + surface.first;
+      G4Exception("DetectorConstruction::ApplySurfaceSettings",
+		  "SNSPDGeometry001", JustWarning,
+		  ("No border surface " + probs.first + ", known are"
+		   + known).c_str());
+    }
+  }
+}
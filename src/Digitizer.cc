@@ -0,0 +1,110 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  Digitizer.cc
+//
+// Description:	End-of-event digitizer turning the hits of an event into
+//		SNSPD pulse features with a per-strip hotspot model.
+
+#include "Digitizer.hh"
+#include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cstdio>
+
+
+// Parse "threshold_eV:window_ns:size_um"; empty keeps the defaults
+
+Digitizer::Digitizer(const G4String& config)
+  : threshold(0.1), window(5.), hotspotSize(1.*um) {
+  if (!config.empty()) {
+    G4double size = 0.;
+    if (std::sscanf(config.c_str(), "%lf:%lf:%lf", &threshold, &window,
+		    &size) != 3 || threshold <= 0. || window <= 0. || size <= 0.) {
+      G4Exception("Digitizer", "SNSPDDigitizer001", FatalException,
+		  ("Bad hotspot model '" + config + "', expected"
+		   " threshold_eV:window_ns:size_um, all > 0").c_str());
+    }
+    hotspotSize = size * um;
+  }
+
+  G4cout << "### Digitizer: hotspot threshold " << threshold << " eV within "
+	 << window << " ns over " << hotspotSize/um << " um of wire" << G4endl;
+}
+
+
+// One pass over the event's hits sorted by (strip, cell, time): a sliding
+// window per cell finds when it switches, and the strip keeps its earliest
+// switch and its total energy
+
+void Digitizer::Digitize(Run* run) const {
+  const HitColumns& hits = run->GetHitRecords();
+
+  cellHits.clear();
+  for (std::size_t i = run->GetEventFirstHit(); i < hits.size(); ++i) {
+    cellHits.push_back({ hits.strip[i], G4int(hits.pathLength[i] / hotspotSize),
+			 hits.time[i], hits.energyDeposit[i] * hits.weight[i] });
+  }
+
+  std::sort(cellHits.begin(), cellHits.end(),
+	    [](const CellHit& a, const CellHit& b) {
+	      return (a.strip < b.strip ||
+		      (a.strip == b.strip && (a.cell < b.cell ||
+		       (a.cell == b.cell && a.time < b.time))));
+	    });
+
+  Run::PulseData pulse = { run->GetEventID(), run->GetSubEvent(), false, -1.,
+			   -1, 0., 0, 0. };
+  std::vector<Run::StripPulse> strips;
+
+  std::size_t begin = 0;
+  while (begin < cellHits.size()) {
+    const G4int strip = cellHits[begin].strip;
+    G4double stripEnergy = 0.;
+    G4double clickTime = -1.;
+    G4int clickCell = -1;
+
+    std::size_t end = begin;
+    for (; end < cellHits.size() && cellHits[end].strip == strip; ++end) {
+      stripEnergy += cellHits[end].energy;
+    }
+
+    // Hits of one cell follow each other; [first, i] is the window
+    std::size_t first = begin;
+    G4double inWindow = 0.;
+    for (std::size_t i = begin; i < end; ++i) {
+      if (i > begin && cellHits[i].cell != cellHits[i-1].cell) {
+	first = i;
+	inWindow = 0.;
+      }
+      inWindow += cellHits[i].energy;
+      while (cellHits[i].time - cellHits[first].time > window) {
+	inWindow -= cellHits[first++].energy;
+      }
+      if (inWindow >= threshold &&
+	  (clickTime < 0. || cellHits[i].time < clickTime)) {
+	clickTime = cellHits[i].time;
+	clickCell = cellHits[i].cell;
+      }
+    }
+
+    pulse.energy += stripEnergy;
+    if (clickTime >= 0.) {
+      strips.push_back({ pulse.eventID, pulse.subEvent, strip, clickTime,
+			 stripEnergy });
+      if (!pulse.detected || clickTime < pulse.firstTime) {
+	pulse.detected = true;
+	pulse.firstTime = clickTime;
+	pulse.firstStrip = strip;
+	pulse.firstPathLength = (clickCell + 0.5) * hotspotSize;
+      }
+    }
+
+    begin = end;
+  }
+
+  pulse.nStrips = strips.size();
+  run->AddPulse(pulse, strips);
+}
@@ -1,25 +1,31 @@
 #include "EventAction.hh"
+#include "Digitizer.hh"
+#include "Run.hh"
 
-EventAction::EventAction(RunAction*, MyG4Args* MainArgs)
+EventAction::EventAction(RunAction* runAction, MyG4Args* MainArgs)
 {
 
+    fRunAction = runAction;
     PassArgs = MainArgs;
+    fDigitizer = 0;
+    if (PassArgs->IsDigitize()) {
+        fDigitizer = new Digitizer(PassArgs->GetHotspotModel());
+    }
 
 }
 
 EventAction::~EventAction()
 {
+    delete fDigitizer;
 
 }
 
 void EventAction::BeginOfEventAction(const G4Event *anEvent)
 {
 	
-    if (PassArgs) {
-        PassArgs->ResetCurrentEvtEdep();
-    } else {
-        G4cerr << "Error: PassArgs is null!" << G4endl;
-    }
+    Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+    run->BeginEvent();
+    if (PassArgs->GetProfile()) run->GetStepProfile().StartClock();
 	
 }
 
@@ -27,9 +33,20 @@ void EventAction::BeginOfEventAction(const G4Event *anEvent)
 void EventAction::EndOfEventAction(const G4Event *anEvent)
 {
   
-    if(PassArgs->GetCurrentEvtEdep() < 1e-15){
-        G4int eventNumber = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
-        PassArgs->AddToEnergyByParticleAndEvent("none", 0, eventNumber);
+    Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+    run->EndEvent();
+
+    // Only the pulse is kept unless the raw hits are asked for too
+    if (fDigitizer) {
+        fDigitizer->Digitize(run);
+        if (!PassArgs->KeepRawHits()) run->DropEventHits();
+    }
+
+    // Stream the buffered events out so memory does not grow with the run.
+    // The run's event count does not include this event yet.
+    G4int flushEvents = PassArgs->GetFlushEvents();
+    if (flushEvents > 0 && (run->GetNumberOfEvent() + 1) % flushEvents == 0) {
+        fRunAction->WriteBufferedEvents(run);
     }
   
 }
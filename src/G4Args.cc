@@ -1,13 +1,17 @@
 #include "G4Args.hh"
 #include <cstring>  // For strcmp
+#include <cstdio>   // For sscanf
 #include <iostream> // For G4cout
 #include <unistd.h> // For exit()
 #include <regex>
+#include <ctime>
 #include "CLHEP/Units/SystemOfUnits.h"
 
 // Constructor: Process command-line arguments
 MyG4Args::MyG4Args(int mainargc, char** mainargv) {
     G4cout << "### Processing Command Line Arguments for the Simulation: " << G4endl;
+    bool runManagerGiven = false;
+    bool seedGiven = false;
 
     for (int j = 1; j < mainargc; ++j) {
         G4cout << mainargv[j] << G4endl;
@@ -129,23 +133,243 @@ MyG4Args::MyG4Args(int mainargc, char** mainargv) {
             globalTimeCut = atof(mainargv[j+1]); j=j+1;
             G4cout<< " ### Stop tracking after "<< globalTimeCut << " ns" <<G4endl;   
                 
+        }else if (strcmp(mainargv[j],"-runManager")==0)
+        {
+
+            runManagerType = mainargv[j+1]; j=j+1;
+            runManagerGiven = true;
+            if (runManagerType != "serial" && runManagerType != "mt" && runManagerType != "tasking") {
+                G4cerr << "### Error: unknown run manager '" << runManagerType << "', expected serial, mt or tasking" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            G4cout<< " ### Use "<< runManagerType << " run manager" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-nThreads")==0)
+        {
+
+            nThreads = atoi(mainargv[j+1]); j=j+1;
+            G4cout<< " ### Process events with "<< nThreads << " worker threads" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-flushEvents")==0)
+        {
+
+            flushEvents = atoi(mainargv[j+1]); j=j+1;
+            if (flushEvents > 0) {
+                G4cout<< " ### Write hits every "<< flushEvents << " events" <<G4endl;
+            } else {
+                G4cout<< " ### Buffer hits until the end of the run" <<G4endl;
+            }
+
+        }else if (strcmp(mainargv[j],"-hitBufferMB")==0)
+        {
+
+            hitBufferMB = atol(mainargv[j+1]); j=j+1;
+            if (hitBufferMB < 0) {
+                G4cerr << "### Error: 'hitBufferMB' must not be negative, got '" << mainargv[j] << "'" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            G4cout<< " ### Keep at most "<< hitBufferMB << " MB of hits per thread in memory, spill the rest to $TMPDIR" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-outputFormat")==0)
+        {
+
+            outputFormat = mainargv[j+1]; j=j+1;
+            if (outputFormat != "root" && outputFormat != "binary" && outputFormat != "both") {
+                G4cerr << "### Error: unknown output format '" << outputFormat << "', expected root, binary or both" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            G4cout<< " ### Write hits as "<< outputFormat <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-seed")==0)
+        {
+
+            masterSeed = atol(mainargv[j+1]); j=j+1;
+            seedGiven = true;
+            G4cout<< " ### Master random seed "<< masterSeed <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-replayEvent")==0)
+        {
+
+            replayEvent = atoi(mainargv[j+1]); j=j+1;
+            G4cout<< " ### Replay event "<< replayEvent << " only" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-phononImportance")==0)
+        {
+
+            phononImportance = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Bias phonons with importance map "<< phononImportance <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-histogramsOnly")==0)
+        {
+
+            histogramsOnly = true;
+            G4cout<< " ### Histogram hits without writing the Hits ntuple" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-digitize")==0)
+        {
+
+            digitize = true;
+            G4cout<< " ### Digitize every event into SNSPD pulse features" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-hotspotModel")==0)
+        {
+
+            hotspotModel = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Hotspot model "<< hotspotModel <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-keepRawHits")==0)
+        {
+
+            keepRawHits = true;
+            G4cout<< " ### Keep the raw hits of digitized events" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-phononBudget")==0 || strcmp(mainargv[j],"-lukeBudget")==0)
+        {
+
+            G4long budget = atol(mainargv[j+1]);
+            if (budget < 0) {
+                G4cerr << "### Error: '" << mainargv[j]+1 << "' must not be negative, got '" << mainargv[j+1] << "'" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            if (strcmp(mainargv[j],"-phononBudget")==0) phononBudget = budget;
+            else lukeBudget = budget;
+            G4cout<< " ### "<< (mainargv[j]+1) <<" "<< budget <<" tracks per event" <<G4endl;
+            j=j+1;
+
+        }else if (strcmp(mainargv[j],"-stepLimits")==0)
+        {
+
+            stepLimits = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Step limits "<< stepLimits <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-profile")==0)
+        {
+
+            profile = true;
+            G4cout<< " ### Profile steps by volume, particle and process" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-writePhaseSpace")==0)
+        {
+
+            writePhaseSpace = true;
+            G4cout<< " ### Stage 1: write particles reaching the chip housing to a phase-space file" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-readPhaseSpace")==0)
+        {
+
+            phaseSpaceInput = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Stage 2: generate events from phase-space file "<< phaseSpaceInput <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-writeDeposits")==0)
+        {
+
+            writeDeposits = true;
+            G4cout<< " ### Write energy deposits in the lattice volumes to a deposit file" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-replayDeposits")==0)
+        {
+
+            depositInput = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Phonon-only replay of the energy deposits in "<< depositInput <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-realizations")==0)
+        {
+
+            realizations = atoi(mainargv[j+1]);
+            if (realizations < 1) {
+                G4cerr << "### Error: 'realizations' must be at least 1, got '" << mainargv[j+1] << "'" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            j=j+1;
+            G4cout<< " ### Replay every event "<< realizations <<" times" <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-shard")==0)
+        {
+
+            // Shard i of N: events [i*runevt/N, (i+1)*runevt/N)
+            if (sscanf(mainargv[j+1], "%d/%d", &shardIndex, &nShards) != 2 ||
+                nShards < 1 || shardIndex < 0 || shardIndex >= nShards) {
+                G4cerr << "### Error: 'shard' expects i/N with 0 <= i < N, got '" << mainargv[j+1] << "'" << G4endl;
+                exit(EXIT_FAILURE);
+            }
+            j=j+1;
+            G4cout<< " ### Run shard "<< shardIndex << " of " << nShards <<G4endl;
+
+        }else if (strcmp(mainargv[j],"-physicsCache")==0)
+        {
+
+            physicsCache = mainargv[j+1]; j=j+1;
+            G4cout<< " ### Physics tables cached in "<< physicsCache <<G4endl;
+
         }
     }
     // makeOutputName();
 
-    if (randomGunLocation && posResScan) {
-        G4cerr << "### Error: both 'rndgun' and 'PosResScan' were activated, however both can't be run." << G4endl;
+    // Asking for threads without naming a run manager selects the task-based one
+    if (nThreads > 1 && !runManagerGiven) {
+        runManagerType = "tasking";
+    }
+
+    // Each shard runs its own slice of the events, writes its own output and
+    // keeps the global event IDs (and therefore seeds and scan positions)
+    if (nShards > 1) {
+        shardFirst = static_cast<G4int>(static_cast<G4long>(shardIndex) * runevt / nShards);
+        shardEvents = static_cast<G4int>(static_cast<G4long>(shardIndex + 1) * runevt / nShards) - shardFirst;
+        OutName += "_shard" + std::to_string(shardIndex);
+        G4cout<< " ### Shard events "<< shardFirst << " to " << shardFirst + shardEvents - 1 << ", output " << OutName <<G4endl;
+    }
+
+    // A deposit replay runs every saved event once per realization; the
+    // realizations of one event are consecutive, and stay in one shard
+    if (!depositInput.empty()) {
+        runevt *= realizations;
+        shardFirst *= realizations;
+        shardEvents *= realizations;
+    } else if (realizations > 1) {
+        G4cerr << "### Error: 'realizations' needs 'replayDeposits'." << G4endl;
         exit(EXIT_FAILURE);
-    }else if (randomGunLocation){
-        for (int i=0; i<runevt; i++) {
+    }
 
-            // Generate random positions within a 10-micron width in X and Y (range: -5 microns to +5 microns)
-            G4double randomX = -25.0 + (static_cast<double>(rand()) / RAND_MAX) * 50.0;  // Random value between -50 and +50 microns
-            G4double randomY = -25.0 + (static_cast<double>(rand()) / RAND_MAX) * 50.0;  // Random value between -50 and +50 microns
-            // Set position with random X and Y, fixed Z at -1.525230 mm (within SiO2 substrate)
-            gunpositions.push_back(G4ThreeVector(randomX / 1000 * CLHEP::mm, randomY / 1000 * CLHEP::mm, -1.525230 * CLHEP::mm));
+    // Without -seed the run is still reproducible from the printed seed
+    if (!seedGiven) {
+        masterSeed = time(NULL);
+        G4cout<< " ### Master random seed "<< masterSeed << " (pass -seed " << masterSeed << " to reproduce)" <<G4endl;
+    }
 
-        }
+    // Scan positions are indexed by event, so a replayed one must exist
+    if (replayEvent >= 0 && posResScan && replayEvent >= runevt) {
+        G4cerr << "### Error: 'replayEvent' " << replayEvent << " is outside the " << runevt << " scan positions." << G4endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The hotspot model and raw hits only matter to the digitizer
+    if ((keepRawHits || !hotspotModel.empty()) && !digitize) {
+        G4cerr << "### Error: 'keepRawHits' and 'hotspotModel' need 'digitize'." << G4endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Stage 2 of a stage-1 run would record nothing new
+    if (writePhaseSpace && !phaseSpaceInput.empty()) {
+        G4cerr << "### Error: 'writePhaseSpace' and 'readPhaseSpace' can't be used together." << G4endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Deposits come from the full physics: stage 1 stops everything before
+    // the chip, and the replay tracks nothing but phonons and charges
+    if (writeDeposits && (writePhaseSpace || !depositInput.empty())) {
+        G4cerr << "### Error: 'writeDeposits' can't be used with 'writePhaseSpace' or 'replayDeposits'." << G4endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!depositInput.empty() && (writePhaseSpace || !phaseSpaceInput.empty())) {
+        G4cerr << "### Error: 'replayDeposits' can't be used with 'writePhaseSpace' or 'readPhaseSpace'." << G4endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // -rndgun positions are drawn per event in PrimaryGeneratorAction, from
+    // the event's own random stream
+    if (randomGunLocation && posResScan) {
+        G4cerr << "### Error: both 'rndgun' and 'PosResScan' were activated, however both can't be run." << G4endl;
+        exit(EXIT_FAILURE);
     }else if (posResScan){
 
         G4ThreeVector currentPos = G4ThreeVector(0. * CLHEP::mm, 0. * CLHEP::mm, 0 * CLHEP::mm);
@@ -167,36 +391,7 @@ MyG4Args::~MyG4Args() {
     // No dynamic memory to clean up
 }
 
-// Add energy deposition to the total for the given particle type and event number
-void MyG4Args::AddToEnergyByParticleAndEvent(const G4String& particleType, G4double energyDeposit, G4int eventNumber) {
-    // Store energy deposit for the specific event number
-    totalEnergyByParticleAndEvent[eventNumber][particleType] += energyDeposit;
-}
-
-// Create a new hit record and append it to the hitRecords vector
-void MyG4Args::AddHitRecord(const G4double energyDeposit, const G4ThreeVector& position, 
-                            // const G4double time, const G4String& particleType) {
-                            const G4double time, const G4int particleType) {
-    HitData newHit = {energyDeposit, position, time, particleType};
-    hitRecords.push_back(newHit);
-}
-
-
-void MyG4Args::ResetTotalEnergyByParticleAndEvent() {
-    // Clear the entire map, removing all its contents
-    totalEnergyByParticleAndEvent.clear();
-
-    G4cout << "Total energy by particle and event has been reinitialized (cleared)." << G4endl;
-}
-
-// Implementation of StorePosition
-void MyG4Args::StorePosition(const G4ThreeVector& position) {
-    // Add the position to the hitRecords with default or placeholder values for other fields
-    gunpositions.push_back(position);
-}
-
-// Implementation of GetPosition
+// Implementation of GetPosition (-PosResScan positions)
 G4ThreeVector MyG4Args::GetPosition(int i) {
-    // Add the position to the hitRecords with default or placeholder values for other fields
     return gunpositions[i];
 }
@@ -0,0 +1,79 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  HitColumns.cc
+//
+// Description:	Hit store of a run, one contiguous array per field
+//		(structure of arrays).
+
+#include "HitColumns.hh"
+#include <algorithm>
+#include <numeric>
+
+
+std::size_t HitColumns::HitSize() {
+  std::size_t bytes = 0;
+  HitColumns().ForEachColumn([&bytes](const auto& column) {
+    bytes += sizeof(column[0]);
+  });
+  return bytes;
+}
+
+
+void HitColumns::Add(G4int event, G4int sub, G4double energy,
+		     const G4ThreeVector& position, G4double hitTime,
+		     G4int particle, G4double trackWeight, G4int track,
+		     G4int hitStrip, G4int hitSegment, G4double hitPathLength) {
+  eventID.push_back(event);
+  subEvent.push_back(sub);
+  energyDeposit.push_back(energy);
+  x.push_back(position.x());
+  y.push_back(position.y());
+  z.push_back(position.z());
+  time.push_back(hitTime);
+  particleType.push_back(particle);
+  weight.push_back(trackWeight);
+  trackID.push_back(track);
+  strip.push_back(hitStrip);
+  segment.push_back(hitSegment);
+  pathLength.push_back(hitPathLength);
+}
+
+void HitColumns::Append(const HitColumns& other, std::size_t begin,
+			std::size_t end) {
+  ForEachColumn(other, [begin, end](auto& column, const auto& from) {
+    column.insert(column.end(), from.begin() + begin, from.begin() + end);
+  });
+}
+
+void HitColumns::Resize(std::size_t n) {
+  ForEachColumn([n](auto& column) { column.resize(n); });
+}
+
+
+// Hits usually arrive in event order already; otherwise the order is
+// found once on the indices and every column is gathered through it
+
+void HitColumns::SortByEvent() {
+  const std::size_t n = size();
+
+  std::size_t i = 1;
+  while (i < n && !EventBefore(i, *this, i-1)) ++i;
+  if (i >= n) return;
+
+  std::vector<std::size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+		   [this](std::size_t a, std::size_t b) {
+		     return EventBefore(a, *this, b);
+		   });
+
+  ForEachColumn([&order, n](auto& column) {
+    auto sorted = column;
+    for (std::size_t k = 0; k < n; ++k) sorted[k] = column[order[k]];
+    column.swap(sorted);
+  });
+}
@@ -0,0 +1,265 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  HitFileReader.cc
+//
+// Description:	Zero-copy reader for the columnar binary hit file (see
+//		HitFileFormat.hh).  The file is memory mapped and every
+//		Block hands out pointers straight into the mapping.
+
+#include "HitFileReader.hh"
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace HitFileFormat;
+
+
+HitFileReader::HitFileReader()
+  : data(nullptr), dataSize(0), nHits(0), firstEvent(0), nEvents(0),
+    savedIndex(false) {;}
+
+HitFileReader::~HitFileReader() {
+  Close();
+}
+
+bool HitFileReader::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "HitFileReader: cannot open " << path << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+    std::cerr << "HitFileReader: " << path << " is too short" << std::endl;
+    close(fd);
+    return false;
+  }
+
+  void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);			// The mapping keeps the file alive
+  if (mapped == MAP_FAILED) {
+    std::cerr << "HitFileReader: cannot map " << path << std::endl;
+    return false;
+  }
+
+  data = static_cast<const char*>(mapped);
+  dataSize = st.st_size;
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.byteOrder != kByteOrderMark) {
+    std::cerr << "HitFileReader: " << path << " is not a hit file"
+	      << " (or was written with the other byte order)" << std::endl;
+    Close();
+    return false;
+  }
+  if (header.version != kVersion) {
+    std::cerr << "HitFileReader: " << path << " has an unknown layout"
+	      << " (version " << header.version << ")" << std::endl;
+    Close();
+    return false;
+  }
+  firstEvent = header.firstEvent;
+  nEvents = header.nEvents;
+
+  std::size_t offset = sizeof(FileHeader);
+  if (offset + header.nColumns*sizeof(ColumnInfo) > dataSize) {
+    std::cerr << "HitFileReader: truncated column table in " << path
+	      << std::endl;
+    Close();
+    return false;
+  }
+  columnTable.resize(header.nColumns);
+  std::memcpy(columnTable.data(), data+offset,
+	      header.nColumns*sizeof(ColumnInfo));
+  offset += header.nColumns*sizeof(ColumnInfo);
+
+  for (const ColumnInfo& info : columnTable) {
+    if (info.type != kInt32 && info.type != kFloat32 && info.type != kUInt8) {
+      std::cerr << "HitFileReader: " << path << " has a column of unknown"
+		<< " type " << int(info.type) << std::endl;
+      Close();
+      return false;
+    }
+  }
+
+  // Index the blocks by walking their headers; this also recovers files
+  // whose writer never got to fill in the header counts.  The walk stops
+  // at the first block whose columns would not fit in it.
+  while (offset + sizeof(BlockHeader) <= dataSize) {
+    BlockHeader block;
+    std::memcpy(&block, data+offset, sizeof(block));
+    if (block.magic != kBlockMagic || block.blockBytes < sizeof(block) ||
+	block.blockBytes > dataSize - offset) break;
+
+    std::uint64_t blockEnd = sizeof(BlockHeader);
+    for (const ColumnInfo& info : columnTable) {
+      blockEnd += Padded(std::size_t(block.nHits) * ElementSize(info.type));
+    }
+    if (blockEnd > block.blockBytes) break;
+
+    blockOffsets.push_back(offset);
+    blockFirstHits.push_back(nHits);
+    nHits += block.nHits;
+    offset += block.blockBytes;
+  }
+
+  if (header.nBlocks != 0 && header.nBlocks != blockOffsets.size()) {
+    std::cerr << "HitFileReader: " << path << " lists " << header.nBlocks
+	      << " blocks but " << blockOffsets.size() << " are readable"
+	      << std::endl;
+  }
+
+  savedIndex = ReadIndex(offset);
+  if (!savedIndex) BuildIndex();
+
+  eventLookup.reserve(eventIndex.size());
+  for (std::size_t i=0; i<eventIndex.size(); ++i) {
+    eventLookup[Key(eventIndex[i].eventID, eventIndex[i].subEvent)] = i;
+  }
+
+  return true;
+}
+
+// The index follows the last block; it only counts if it covers exactly
+// the blocks that were found, else it is rebuilt from the event columns
+
+bool HitFileReader::ReadIndex(std::size_t offset) {
+  IndexHeader header;
+  if (offset + sizeof(header) > dataSize) return false;
+  std::memcpy(&header, data+offset, sizeof(header));
+  if (header.magic != kIndexMagic ||
+      header.nEvents > (dataSize - offset - sizeof(header))/sizeof(IndexEntry)) {
+    return false;
+  }
+
+  eventIndex.resize(header.nEvents);
+  std::memcpy(eventIndex.data(), data+offset+sizeof(header),
+	      header.nEvents*sizeof(IndexEntry));
+
+  // Every entry must lie within its block
+  std::uint64_t nIndexed = 0;
+  for (const IndexEntry& entry : eventIndex) {
+    const std::size_t b = entry.block;
+    if (b >= blockOffsets.size()) {
+      eventIndex.clear();
+      return false;
+    }
+    const std::uint64_t blockFirst = blockFirstHits[b];
+    const std::uint64_t blockHits =
+      (b+1 < blockFirstHits.size() ? blockFirstHits[b+1] : nHits) - blockFirst;
+    if (entry.firstHit < blockFirst ||
+	entry.firstHit - blockFirst > blockHits ||
+	entry.nHits > blockHits - (entry.firstHit - blockFirst)) {
+      eventIndex.clear();
+      return false;
+    }
+    nIndexed += entry.nHits;
+  }
+  if (nIndexed != nHits) {
+    eventIndex.clear();
+    return false;
+  }
+  return true;
+}
+
+// One pass over the event columns; files from before the SubEvent column
+// hold sub-event 0 only
+
+void HitFileReader::BuildIndex() {
+  eventIndex.clear();
+
+  int iEvent = FindColumn("EventID");
+  int iSubEvent = FindColumn("SubEvent");
+  if (iEvent < 0) return;
+
+  for (std::size_t b=0; b<blockOffsets.size(); ++b) {
+    Block block = GetBlock(b);
+    const std::int32_t* eventID = block.Column<std::int32_t>(iEvent);
+    const std::int32_t* subEvent = block.Column<std::int32_t>(iSubEvent);
+    for (std::uint32_t i=0; i<block.size(); ++i) {
+      std::int32_t sub = subEvent ? subEvent[i] : 0;
+      if (i == 0 || eventID[i] != eventIndex.back().eventID ||
+	  sub != eventIndex.back().subEvent) {
+	eventIndex.push_back({ eventID[i], sub, blockFirstHits[b] + i, 0,
+			       std::uint32_t(b) });
+      }
+      ++eventIndex.back().nHits;
+    }
+  }
+}
+
+void HitFileReader::Close() {
+  if (data) munmap(const_cast<char*>(data), dataSize);
+  data = nullptr;
+  dataSize = 0;
+  columnTable.clear();
+  blockOffsets.clear();
+  blockFirstHits.clear();
+  nHits = 0;
+  firstEvent = 0;
+  nEvents = 0;
+  eventIndex.clear();
+  eventLookup.clear();
+  savedIndex = false;
+}
+
+// Names fill at most the whole field; the NUL is not relied on
+
+int HitFileReader::FindColumn(const std::string& name) const {
+  for (std::size_t i=0; i<columnTable.size(); ++i) {
+    const ColumnInfo& info = columnTable[i];
+    if (name == std::string(info.name, strnlen(info.name, sizeof(info.name))))
+      return (int)i;
+  }
+  return -1;
+}
+
+HitFileReader::Block HitFileReader::GetBlock(std::size_t i) const {
+  Block block;
+
+  BlockHeader header;
+  std::memcpy(&header, data+blockOffsets[i], sizeof(header));
+  block.nHits = header.nHits;
+
+  const char* column = data + blockOffsets[i] + sizeof(BlockHeader);
+  block.columns.reserve(columnTable.size());
+  for (const ColumnInfo& info : columnTable) {
+    block.columns.push_back(column);
+    column += Padded(header.nHits * ElementSize(info.type));
+  }
+
+  return block;
+}
+
+const IndexEntry* HitFileReader::FindEvent(int eventID, int subEvent) const {
+  auto found = eventLookup.find(Key(eventID, subEvent));
+  return (found == eventLookup.end()) ? nullptr : &eventIndex[found->second];
+}
+
+// The event's slice of its block: every column advanced to its first hit
+
+HitFileReader::Block HitFileReader::GetEventHits(int eventID,
+						 int subEvent) const {
+  const IndexEntry* entry = FindEvent(eventID, subEvent);
+  if (!entry) return Block();
+
+  Block block = GetBlock(entry->block);
+  const std::uint64_t first = entry->firstHit - blockFirstHits[entry->block];
+  for (std::size_t c=0; c<columnTable.size(); ++c) {
+    block.columns[c] += first * ElementSize(columnTable[c].type);
+  }
+  block.nHits = entry->nHits;
+  return block;
+}
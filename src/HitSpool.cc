@@ -0,0 +1,152 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  HitSpool.cc
+//
+// Description:	Overflow of a run's hit buffer (-hitBufferMB), spilled
+//		to a temporary file in sorted chunks and merged back in
+//		event order when the hits are written.
+
+#include "HitSpool.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+
+HitSpool::HitSpool() : nHits(0) {;}
+
+HitSpool::~HitSpool() {;}
+
+
+// The columns are written as they are in memory: the file is only ever
+// read back by the same process
+
+void HitSpool::Spill(HitColumns& hits) {
+  if (hits.empty()) return;
+
+  if (!file) {
+    const char* dir = std::getenv("TMPDIR");
+    std::string name = std::string(dir && *dir ? dir : "/tmp")
+      + "/SNSPDHits.XXXXXX";
+    const int fd = mkstemp(&name[0]);
+    std::FILE* spill = (fd < 0) ? 0 : fdopen(fd, "w+b");
+    if (!spill) {
+      G4Exception("HitSpool::Spill", "SNSPDHitSpool001", FatalException,
+		  ("Cannot create the hit spill file " + name).c_str());
+      return;
+    }
+    unlink(name.c_str());
+    file.reset(spill, std::fclose);
+  }
+
+  hits.SortByEvent();
+
+  const std::size_t n = hits.size();
+  std::FILE* out = file.get();
+  std::fseek(out, 0, SEEK_END);
+  const long offset = std::ftell(out);
+
+  G4bool written = true;
+  hits.ForEachColumn([out, n, &written](const auto& column) {
+    written = written &&
+      std::fwrite(column.data(), sizeof(column[0]), n, out) == n;
+  });
+  if (!written || std::fflush(out) != 0) {
+    G4Exception("HitSpool::Spill", "SNSPDHitSpool002", FatalException,
+		"Cannot write the hit spill file, is $TMPDIR full?");
+    return;
+  }
+
+  chunks.push_back({ file, offset, n, 0, HitColumns(), 0 });
+  nHits += n;
+  hits.Clear();
+}
+
+void HitSpool::Merge(const HitSpool& other) {
+  for (const Chunk& chunk : other.chunks) {
+    chunks.push_back({ chunk.file, chunk.offset, chunk.nHits, 0,
+		       HitColumns(), 0 });
+  }
+  nHits += other.nHits;
+}
+
+void HitSpool::Clear() {
+  chunks.clear();
+  file.reset();			// Start a new file once these are released
+  nHits = 0;
+}
+
+
+// Read ahead the same range of every column
+
+G4bool HitSpool::Fill(Chunk& chunk, std::size_t readAhead) const {
+  if (chunk.next < chunk.buffer.size()) return true;
+  if (chunk.nRead == chunk.nHits) return false;
+
+  const std::size_t n = std::min(chunk.nHits - chunk.nRead, readAhead);
+  std::FILE* in = chunk.file.get();
+  long column = chunk.offset;
+  G4bool read = true;
+  chunk.buffer.ForEachColumn([&](auto& values) {
+    values.resize(n);
+    std::fseek(in, column + chunk.nRead * sizeof(values[0]), SEEK_SET);
+    read = read && std::fread(values.data(), sizeof(values[0]), n, in) == n;
+    column += chunk.nHits * sizeof(values[0]);
+  });
+
+  if (!read) {
+    G4Exception("HitSpool::Read", "SNSPDHitSpool003", FatalException,
+		"Cannot read back the hit spill file");
+    chunk.buffer.Clear();
+    chunk.nRead = chunk.nHits;
+    return false;
+  }
+
+  chunk.nRead += n;
+  chunk.next = 0;
+  return true;
+}
+
+// Each chunk is sorted and every event lies in one chunk, so the next
+// event is the smallest at the head of any chunk.  The read-ahead buffers
+// share the maxHits budget.
+
+G4bool HitSpool::Read(HitColumns& hits, std::size_t maxHits) {
+  hits.Clear();
+  if (chunks.empty()) return false;
+
+  const std::size_t readAhead =
+    std::max<std::size_t>(64, maxHits / chunks.size());
+
+  while (hits.size() < maxHits) {
+    Chunk* first = 0;
+    for (Chunk& chunk : chunks) {
+      if (Fill(chunk, readAhead) &&
+	  (!first || chunk.buffer.EventBefore(chunk.next, first->buffer,
+					      first->next))) {
+	first = &chunk;
+      }
+    }
+    if (!first) break;
+
+    // The event may run past the read-ahead buffer
+    const HitColumns& buffer = first->buffer;
+    const G4int event = buffer.eventID[first->next];
+    const G4int sub = buffer.subEvent[first->next];
+    do {
+      std::size_t end = first->next;
+      while (end < buffer.size() && buffer.SameEvent(end, event, sub)) ++end;
+      hits.Append(buffer, first->next, end);
+      first->next = end;
+    } while (Fill(*first, readAhead) &&
+	     buffer.SameEvent(first->next, event, sub));
+  }
+
+  // Release the read-ahead memory once the last chunk is done
+  if (hits.empty()) Clear();
+  return !hits.empty();
+}
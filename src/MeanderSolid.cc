@@ -0,0 +1,556 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  MeanderSolid.cc
+//
+// Description:	Solid for the SNSPD meander, answering navigation queries
+//		from the one strip and wrap a point can belong to.  The
+//		parts are the same G4Box and G4Tubs (and combined the same
+//		way) as in the G4MultiUnion it replaces.
+
+#include "MeanderSolid.hh"
+#include "DetectorParameters.hh"
+#include "G4AffineTransform.hh"
+#include "G4BoundingEnvelope.hh"
+#include "G4Box.hh"
+#include "G4MultiUnion.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4Polyhedron.hh"
+#include "G4SolidStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Tubs.hh"
+#include "G4VGraphicsScene.hh"
+#include "G4VoxelLimits.hh"
+#include "Randomize.hh"
+#include <algorithm>
+#include <cmath>
+
+
+MeanderLayout MeanderLayout::FromDetectorParameters() {
+  using namespace DetectorParameters;
+
+  MeanderLayout layout;
+  layout.stripLength = dp_stripDimX;
+  layout.stripWidth = dp_stripThickness;
+  layout.stripSpacing = dp_stripSpacing;
+  layout.filmThickness = dp_stripDimZ;
+  layout.firstStripY = -dp_stripDimY/2;
+  layout.nStrips = dp_numStrips;
+  return layout;
+}
+
+
+G4int MeanderLayout::NearestStrip(G4double y) const {
+  G4int i = static_cast<G4int>(std::lround((y - firstStripY)/Pitch()));
+  return std::min(std::max(i, 0), nStrips-1);
+}
+
+// Wrap j is centred at firstStripY + (j+0.5)*pitch; those of one parity
+// are two pitches apart
+
+G4int MeanderLayout::NearestWrap(G4double y, G4int parity) const {
+  G4int last = nStrips - 2;
+  if ((last - parity) % 2 != 0) --last;
+  if (last < parity) return -1;
+
+  G4double u = (y - firstStripY)/Pitch() - 0.5 - parity;
+  G4int j = parity + 2*static_cast<G4int>(std::lround(u/2));
+  return std::min(std::max(j, parity), last);
+}
+
+G4double MeanderLayout::WireLength() const {
+  return nStrips*stripLength + (nStrips-1)*pi*Pitch()/2;
+}
+
+// The wire runs along +x on even strips and -x on odd ones, turning
+// through the wraps; beyond the strip ends (x outside the strips) a point
+// is in a wrap if there is one on that side, else at the free end
+
+MeanderPosition MeanderLayout::Locate(const G4ThreeVector& p) const {
+  const G4double halfLength = stripLength/2;
+  const G4double turn = pi*Pitch()/2;		// Centre line of a wrap
+
+  if (std::abs(p.x()) > halfLength) {
+    G4int parity = (p.x() > 0.) ? 0 : 1;
+    G4int j = NearestWrap(p.y(), parity);
+    G4double dy = (j >= 0) ? p.y() - (StripY(j) + Pitch()/2) : 0.;
+    if (j >= 0 && std::abs(dy) <= OuterRadius()) {
+      // Angle from the strip it leaves (j), -pi/2, to the next, +pi/2
+      G4double dx = std::abs(p.x()) - halfLength;
+      G4double phi = std::atan2(dy, dx);
+      G4double s = (j+1)*stripLength + j*turn + (phi + halfpi) * Pitch()/2;
+      return { NearestStrip(p.y()), 2*j+1, s };
+    }
+  }
+
+  G4int i = NearestStrip(p.y());
+  G4double x = std::min(std::max(p.x(), -halfLength), halfLength);
+  G4double along = (i%2 == 0) ? x + halfLength : halfLength - x;
+  return { i, 2*i, i*(stripLength + turn) + along };
+}
+
+
+// Constructors and destructor
+
+MeanderSolid::MeanderSolid(const G4String& name, const MeanderLayout& layout)
+  : G4VSolid(name), fLayout(layout), fPitch(layout.Pitch()),
+    fHalfTolerance(0.5*kCarTolerance), fStrip(nullptr), fWrap(nullptr),
+    fCubicVolume(0.), fSurfaceArea(0.) {
+  if (layout.nStrips < 1 || layout.stripLength <= 0. ||
+      layout.stripWidth <= 0. || layout.stripSpacing <= 0. ||
+      layout.filmThickness <= 0.) {
+    G4Exception("MeanderSolid::MeanderSolid", "SNSPDMeander001",
+		FatalException, ("Invalid meander dimensions for " + name).c_str());
+  }
+  MakePrimitives();
+}
+
+MeanderSolid::MeanderSolid(const MeanderSolid& rhs)
+  : G4VSolid(rhs), fLayout(rhs.fLayout), fPitch(rhs.fPitch),
+    fHalfTolerance(rhs.fHalfTolerance), fStrip(nullptr), fWrap(nullptr),
+    fCubicVolume(rhs.fCubicVolume), fSurfaceArea(rhs.fSurfaceArea) {
+  MakePrimitives();
+}
+
+MeanderSolid::~MeanderSolid() {
+  delete fStrip;
+  delete fWrap;
+}
+
+// The primitives are owned here, so they are kept out of the solid store
+// (which deletes its contents when the geometry is rebuilt)
+
+void MeanderSolid::MakePrimitives() {
+  const G4double halfZ = fLayout.filmThickness/2;
+
+  fStrip = new G4Box(GetName()+"_strip", fLayout.stripLength/2,
+		     fLayout.stripWidth/2, halfZ);
+  fWrap = new G4Tubs(GetName()+"_wrap", fLayout.InnerRadius(),
+		     fLayout.OuterRadius(), halfZ, 0.*deg, 180.*deg);
+  G4SolidStore::DeRegister(fStrip);
+  G4SolidStore::DeRegister(fWrap);
+
+  const G4double xWrap = (fLayout.nStrips > 1) ? fLayout.OuterRadius() : 0.;
+  fMin.set(-fLayout.stripLength/2 - xWrap,
+	   StripY(0) - fLayout.stripWidth/2, -halfZ);
+  fMax.set(fLayout.stripLength/2 + xWrap,
+	   StripY(fLayout.nStrips-1) + fLayout.stripWidth/2, halfZ);
+}
+
+
+// Same nodes and transforms as the loop formerly in SetupGeometry
+
+G4MultiUnion* MeanderSolid::BuildMultiUnion(const G4String& name) const {
+  G4MultiUnion* solid = new G4MultiUnion(name);
+
+  for (G4int i=0; i<fLayout.nStrips; ++i) {
+    solid->AddNode(*fStrip, G4Transform3D(G4RotationMatrix(),
+					  G4ThreeVector(0., StripY(i), 0.)));
+
+    if (i+1 < fLayout.nStrips) {
+      G4double zRot = (i%2 == 0) ? 90.*deg : 270.*deg;
+      G4double xWrap = (i%2 == 0) ? fLayout.stripLength/2 : -fLayout.stripLength/2;
+      solid->AddNode(*fWrap,
+		     G4Transform3D(G4RotationMatrix(0., 0., zRot),
+				   G4ThreeVector(xWrap, StripY(i)+fPitch/2, 0.)));
+    }
+  }
+
+  solid->Voxelize();
+  return solid;
+}
+
+
+// Locating parts by modular arithmetic
+
+G4int MeanderSolid::NearestStrip(G4double y) const {
+  return fLayout.NearestStrip(y);
+}
+
+G4int MeanderSolid::NearestWrap(G4double y, G4int parity) const {
+  return fLayout.NearestWrap(y, parity);
+}
+
+// Strips never come within a tolerance of each other, and wraps lie
+// entirely beyond the strip ends (even ones at +x, odd ones at -x)
+
+G4int MeanderSolid::PartsNear(const G4ThreeVector& p, Part parts[2]) const {
+  G4int nParts = 0;
+  parts[nParts++] = { false, NearestStrip(p.y()) };
+
+  const G4double xEnd = fLayout.stripLength/2 - fHalfTolerance;
+  G4int parity = (p.x() >= xEnd) ? 0 : (p.x() <= -xEnd) ? 1 : -1;
+  if (parity >= 0) {
+    G4int j = NearestWrap(p.y(), parity);
+    if (j >= 0) parts[nParts++] = { true, j };
+  }
+
+  return nParts;
+}
+
+
+// Wraps are rotated by -90 deg (even, opening towards +x) or +90 deg (odd,
+// towards -x) about z, matching G4RotationMatrix(0,0,90 or 270 deg)
+
+G4ThreeVector MeanderSolid::ToLocal(const Part& part,
+				    const G4ThreeVector& p) const {
+  if (!part.isWrap) return G4ThreeVector(p.x(), p.y()-StripY(part.index), p.z());
+
+  G4double xWrap = (part.index%2 == 0) ? fLayout.stripLength/2
+    : -fLayout.stripLength/2;
+  return DirToLocal(part, p - G4ThreeVector(xWrap, StripY(part.index)+fPitch/2, 0.));
+}
+
+G4ThreeVector MeanderSolid::DirToLocal(const Part& part,
+				       const G4ThreeVector& v) const {
+  if (!part.isWrap) return v;
+  return (part.index%2 == 0) ? G4ThreeVector(-v.y(), v.x(), v.z())
+    : G4ThreeVector(v.y(), -v.x(), v.z());
+}
+
+G4ThreeVector MeanderSolid::DirToGlobal(const Part& part,
+					const G4ThreeVector& v) const {
+  if (!part.isWrap) return v;
+  return (part.index%2 == 0) ? G4ThreeVector(v.y(), -v.x(), v.z())
+    : G4ThreeVector(-v.y(), v.x(), v.z());
+}
+
+const G4VSolid* MeanderSolid::Primitive(const Part& part) const {
+  return part.isWrap ? static_cast<const G4VSolid*>(fWrap) : fStrip;
+}
+
+EInside MeanderSolid::PartInside(const Part& part,
+				 const G4ThreeVector& p) const {
+  return Primitive(part)->Inside(ToLocal(part, p));
+}
+
+G4double MeanderSolid::PartDistanceToIn(const Part& part,
+					const G4ThreeVector& p,
+					const G4ThreeVector& v) const {
+  return Primitive(part)->DistanceToIn(ToLocal(part, p), DirToLocal(part, v));
+}
+
+G4double MeanderSolid::PartDistanceToOut(const Part& part,
+					 const G4ThreeVector& p,
+					 const G4ThreeVector& v,
+					 G4ThreeVector& n) const {
+  G4bool validNorm = false;
+  G4ThreeVector localNorm;
+  G4double dist = Primitive(part)->DistanceToOut(ToLocal(part, p),
+						 DirToLocal(part, v), true,
+						 &validNorm, &localNorm);
+  n = DirToGlobal(part, localNorm);
+  return dist;
+}
+
+
+// A point on the touching faces of a strip and its wrap (opposite normals)
+// is inside the meander, as for the union
+
+EInside MeanderSolid::Inside(const G4ThreeVector& p) const {
+  for (G4int k=0; k<3; ++k) {
+    if (p[k] < fMin[k]-fHalfTolerance || p[k] > fMax[k]+fHalfTolerance)
+      return kOutside;
+  }
+
+  Part parts[2];
+  G4int nParts = PartsNear(p, parts);
+
+  G4int nSurface = 0;
+  G4ThreeVector normals[2];
+  for (G4int k=0; k<nParts; ++k) {
+    EInside location = PartInside(parts[k], p);
+    if (location == kInside) return kInside;
+    if (location == kSurface) {
+      normals[nSurface++] =
+	DirToGlobal(parts[k], Primitive(parts[k])->SurfaceNormal(ToLocal(parts[k], p)));
+    }
+  }
+
+  if (nSurface == 2 && normals[0].dot(normals[1]) < 0.) return kInside;
+  return (nSurface > 0) ? kSurface : kOutside;
+}
+
+G4ThreeVector MeanderSolid::SurfaceNormal(const G4ThreeVector& p) const {
+  Part parts[2];
+  G4int nParts = PartsNear(p, parts);
+
+  // Normal of the part whose surface is closest to p
+  G4ThreeVector normal(0., 0., 1.);
+  G4double closest = kInfinity;
+  for (G4int k=0; k<nParts; ++k) {
+    const G4VSolid* solid = Primitive(parts[k]);
+    G4ThreeVector local = ToLocal(parts[k], p);
+    G4double dist = (solid->Inside(local) == kOutside)
+      ? solid->DistanceToIn(local) : solid->DistanceToOut(local);
+    if (dist < closest) {
+      closest = dist;
+      normal = DirToGlobal(parts[k], solid->SurfaceNormal(local));
+    }
+  }
+
+  return normal;
+}
+
+
+// March through the strip pitches the ray crosses, in order, stopping once
+// the next pitch starts beyond the closest hit so far.  Each pitch holds
+// one strip and parts of the wraps on either side of it.
+
+G4double MeanderSolid::DistanceToIn(const G4ThreeVector& p,
+				    const G4ThreeVector& v) const {
+  G4double tMin, tMax;
+  if (!ClipToBox(p, v, tMin, tMax)) return kInfinity;
+
+  const G4int iFirst = NearestStrip(p.y() + tMin*v.y());
+  const G4int iLast  = NearestStrip(p.y() + tMax*v.y());
+  const G4int step = (iLast >= iFirst) ? 1 : -1;
+
+  G4double dist = kInfinity;
+  for (G4int i=iFirst; ; i+=step) {
+    if (i != iFirst) {		// v.y() is nonzero here
+      G4double tPitch = (StripY(i) - step*fPitch/2 - p.y()) / v.y();
+      if (tPitch > dist) break;
+    }
+
+    dist = std::min(dist, PartDistanceToIn({ false, i }, p, v));
+
+    for (G4int j=i-1; j<=i; ++j) {
+      if (j < 0 || j > fLayout.nStrips-2) continue;
+      if (i != iFirst && j == (step > 0 ? i-1 : i)) continue;	// Done already
+      dist = std::min(dist, PartDistanceToIn({ true, j }, p, v));
+    }
+
+    if (i == iLast) break;
+  }
+
+  return dist;
+}
+
+// The nearest strip is the closest of all strips.  Of the wraps, the
+// nearest of each parity and its neighbours are checked; all others are
+// at least 3 pitches less the outer radius away in y.
+
+G4double MeanderSolid::DistanceToIn(const G4ThreeVector& p) const {
+  G4double safety = fStrip->DistanceToIn(ToLocal({ false, NearestStrip(p.y()) }, p));
+
+  for (G4int parity=0; parity<2; ++parity) {
+    G4int jNearest = NearestWrap(p.y(), parity);
+    if (jNearest < 0) continue;
+
+    for (G4int j=jNearest-2; j<=jNearest+2; j+=2) {
+      if (j < 0 || j > fLayout.nStrips-2) continue;
+      safety = std::min(safety, fWrap->DistanceToIn(ToLocal({ true, j }, p)));
+    }
+  }
+  safety = std::min(safety, 3*fPitch - fLayout.OuterRadius());
+
+  // Far from the meander the bounding box is the better estimate
+  G4ThreeVector outside;
+  for (G4int k=0; k<3; ++k) {
+    outside[k] = std::max(std::max(fMin[k] - p[k], p[k] - fMax[k]), 0.);
+  }
+
+  return std::max(safety, outside.mag());
+}
+
+// Leaving a strip through its end continues into the wrap and vice versa
+
+G4double MeanderSolid::DistanceToOut(const G4ThreeVector& p,
+				     const G4ThreeVector& v,
+				     const G4bool calcNorm,
+				     G4bool* validNorm,
+				     G4ThreeVector* n) const {
+  G4double total = 0.;
+  G4ThreeVector normal(0., 0., 1.);
+  G4ThreeVector q = p;
+
+  const G4int maxParts = 2*fLayout.nStrips;	// Each part at most once
+  for (G4int crossing=0; crossing<maxParts; ++crossing) {
+    Part parts[2];
+    G4int nParts = PartsNear(q, parts);
+
+    G4double dist = -1.;
+    G4ThreeVector partNormal;
+    for (G4int k=0; k<nParts; ++k) {
+      if (PartInside(parts[k], q) == kOutside) continue;
+
+      G4ThreeVector kNormal;
+      G4double kDist = PartDistanceToOut(parts[k], q, v, kNormal);
+      if (kDist > dist) {
+	dist = kDist;
+	partNormal = kNormal;
+      }
+    }
+
+    if (dist < 0.) break;				// Not in any part
+    if (crossing > 0 && dist <= fHalfTolerance) break;	// No progress
+
+    total += dist;
+    normal = partNormal;
+    q = p + total*v;
+
+    if (Inside(q) != kInside) break;		// Left the meander itself
+  }
+
+  if (calcNorm) {
+    // The whole film lies behind its top and bottom faces
+    *validNorm = (std::abs(normal.z()) == 1.);
+    *n = normal;
+  }
+
+  return total;
+}
+
+// Any ball inside one part is inside the meander
+
+G4double MeanderSolid::DistanceToOut(const G4ThreeVector& p) const {
+  Part parts[2];
+  G4int nParts = PartsNear(p, parts);
+
+  G4double safety = 0.;
+  for (G4int k=0; k<nParts; ++k) {
+    const G4VSolid* solid = Primitive(parts[k]);
+    G4ThreeVector local = ToLocal(parts[k], p);
+    if (solid->Inside(local) != kOutside) {
+      safety = std::max(safety, solid->DistanceToOut(local));
+    }
+  }
+
+  return safety;
+}
+
+
+G4bool MeanderSolid::ClipToBox(const G4ThreeVector& p, const G4ThreeVector& v,
+			       G4double& tMin, G4double& tMax) const {
+  tMin = 0.;
+  tMax = kInfinity;
+  for (G4int k=0; k<3; ++k) {
+    G4double lo = fMin[k] - fHalfTolerance;
+    G4double hi = fMax[k] + fHalfTolerance;
+    if (v[k] == 0.) {
+      if (p[k] < lo || p[k] > hi) return false;
+      continue;
+    }
+
+    G4double t1 = (lo - p[k]) / v[k];
+    G4double t2 = (hi - p[k]) / v[k];
+    if (t1 > t2) std::swap(t1, t2);
+    tMin = std::max(tMin, t1);
+    tMax = std::min(tMax, t2);
+    if (tMin > tMax) return false;
+  }
+
+  return true;
+}
+
+
+// Extent, volume and surface
+
+void MeanderSolid::BoundingLimits(G4ThreeVector& pMin,
+				  G4ThreeVector& pMax) const {
+  pMin = fMin;
+  pMax = fMax;
+}
+
+G4bool MeanderSolid::CalculateExtent(const EAxis pAxis,
+				     const G4VoxelLimits& pVoxelLimit,
+				     const G4AffineTransform& pTransform,
+				     G4double& pMin, G4double& pMax) const {
+  G4BoundingEnvelope bbox(fMin, fMax);
+  return bbox.CalculateExtent(pAxis, pVoxelLimit, pTransform, pMin, pMax);
+}
+
+G4double MeanderSolid::GetCubicVolume() {
+  if (fCubicVolume == 0.) {
+    const G4double rIn = fLayout.InnerRadius(), rOut = fLayout.OuterRadius();
+    fCubicVolume = fLayout.filmThickness *
+      (fLayout.nStrips * fLayout.stripLength * fLayout.stripWidth +
+       (fLayout.nStrips-1) * halfpi * (rOut*rOut - rIn*rIn));
+  }
+  return fCubicVolume;
+}
+
+// Strip ends joined to a wrap are interior, as are the wrap's cut faces
+
+G4double MeanderSolid::GetSurfaceArea() {
+  if (fSurfaceArea == 0.) {
+    const G4double rIn = fLayout.InnerRadius(), rOut = fLayout.OuterRadius();
+    const G4double length = fLayout.stripLength, width = fLayout.stripWidth;
+    const G4double dz = fLayout.filmThickness;
+
+    G4double strip = 2.*(length*width + length*dz + width*dz);
+    G4double wrap = pi*(rOut*rOut - rIn*rIn) + pi*(rOut + rIn)*dz
+      + 2.*(rOut - rIn)*dz;
+    G4double joints = 4.*width*dz;
+
+    fSurfaceArea = fLayout.nStrips*strip + (fLayout.nStrips-1)*(wrap - joints);
+  }
+  return fSurfaceArea;
+}
+
+// Pick a part by area, then a point on it that is not on a joint
+
+G4ThreeVector MeanderSolid::GetPointOnSurface() const {
+  const G4double stripArea = const_cast<G4Box*>(fStrip)->GetSurfaceArea();
+  const G4double wrapArea = const_cast<G4Tubs*>(fWrap)->GetSurfaceArea();
+  const G4double totalStrips = fLayout.nStrips * stripArea;
+  const G4double total = totalStrips + (fLayout.nStrips-1) * wrapArea;
+
+  G4ThreeVector point;
+  for (G4int attempt=0; attempt<1000; ++attempt) {
+    G4double u = total * G4UniformRand();
+    Part part = (u < totalStrips)
+      ? Part{ false, std::min(G4int(u/stripArea), fLayout.nStrips-1) }
+      : Part{ true, std::min(G4int((u-totalStrips)/wrapArea), fLayout.nStrips-2) };
+
+    G4ThreeVector local = Primitive(part)->GetPointOnSurface();
+    if (part.isWrap) {
+      G4double xWrap = (part.index%2 == 0) ? fLayout.stripLength/2
+	: -fLayout.stripLength/2;
+      point = DirToGlobal(part, local)
+	+ G4ThreeVector(xWrap, StripY(part.index)+fPitch/2, 0.);
+    } else {
+      point = local + G4ThreeVector(0., StripY(part.index), 0.);
+    }
+
+    if (Inside(point) == kSurface) break;
+  }
+
+  return point;
+}
+
+
+// Output and visualization
+
+std::ostream& MeanderSolid::StreamInfo(std::ostream& os) const {
+  G4long oldprc = os.precision(16);
+  os << "-----------------------------------------------------------\n"
+     << "    *** Dump for solid - " << GetName() << " ***\n"
+     << "    ===================================================\n"
+     << " Solid type: MeanderSolid\n"
+     << " Parameters: \n"
+     << "   number of strips: " << fLayout.nStrips << "\n"
+     << "   strip length: " << fLayout.stripLength/mm << " mm\n"
+     << "   strip width: " << fLayout.stripWidth/nm << " nm\n"
+     << "   strip spacing: " << fLayout.stripSpacing/nm << " nm\n"
+     << "   film thickness: " << fLayout.filmThickness/nm << " nm\n"
+     << "   first strip at y = " << fLayout.firstStripY/mm << " mm\n"
+     << "-----------------------------------------------------------\n";
+  os.precision(oldprc);
+  return os;
+}
+
+void MeanderSolid::DescribeYourselfTo(G4VGraphicsScene& scene) const {
+  scene.AddSolid(*this);
+}
+
+G4Polyhedron* MeanderSolid::CreatePolyhedron() const {
+  G4MultiUnion* solid = BuildMultiUnion(GetName()+"_vis");
+  G4Polyhedron* polyhedron = solid->CreatePolyhedron();
+  delete solid;
+  return polyhedron;
+}
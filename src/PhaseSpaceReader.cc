@@ -0,0 +1,130 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  PhaseSpaceReader.cc
+//
+// Description:	Memory-mapped reader for phase-space files (see
+//		PhaseSpaceFormat.hh).
+
+#include "PhaseSpaceReader.hh"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PhaseSpaceFormat;
+
+
+PhaseSpaceReader::PhaseSpaceReader()
+  : data(nullptr), dataSize(0), nRecords(0),
+    recordType(kParticleRecords), recordSize(sizeof(Record)) {;}
+
+PhaseSpaceReader::~PhaseSpaceReader() {
+  Close();
+}
+
+bool PhaseSpaceReader::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "PhaseSpaceReader: cannot open " << path << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+    std::cerr << "PhaseSpaceReader: " << path << " is too short" << std::endl;
+    close(fd);
+    return false;
+  }
+
+  void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);			// The mapping keeps the file alive
+  if (mapped == MAP_FAILED) {
+    std::cerr << "PhaseSpaceReader: cannot map " << path << std::endl;
+    return false;
+  }
+
+  data = static_cast<const char*>(mapped);
+  dataSize = st.st_size;
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.byteOrder != kByteOrderMark) {
+    std::cerr << "PhaseSpaceReader: " << path << " is not a phase-space file"
+	      << " (or was written with the other byte order)" << std::endl;
+    Close();
+    return false;
+  }
+
+  const std::size_t expectedSize = (header.recordType == kDepositRecords)
+    ? sizeof(Deposit) : sizeof(Record);
+  if (header.version != kVersion || header.recordType >= kNRecordTypes ||
+      header.recordSize != expectedSize) {
+    std::cerr << "PhaseSpaceReader: " << path << " has an unknown layout"
+	      << " (version " << header.version << ", record type "
+	      << header.recordType << ")" << std::endl;
+    Close();
+    return false;
+  }
+  recordType = static_cast<RecordType>(header.recordType);
+  recordSize = header.recordSize;
+
+  const std::size_t recordsEnd =
+    sizeof(FileHeader) + header.nRecords*recordSize;
+  if (header.indexOffset < recordsEnd ||
+      header.indexOffset + header.nEvents*sizeof(IndexEntry) > dataSize) {
+    std::cerr << "PhaseSpaceReader: " << path << " has no valid event index"
+	      << " (stage 1 did not finish?)" << std::endl;
+    Close();
+    return false;
+  }
+
+  index.resize(header.nEvents);
+  std::memcpy(index.data(), data+header.indexOffset,
+	      header.nEvents*sizeof(IndexEntry));
+  nRecords = header.nRecords;
+
+  for (const IndexEntry& entry : index) {
+    if (entry.firstRecord + entry.nRecords > nRecords) {
+      std::cerr << "PhaseSpaceReader: event " << entry.eventID << " in "
+		<< path << " points past the records" << std::endl;
+      Close();
+      return false;
+    }
+  }
+
+  // Worker threads flush in any order
+  std::sort(index.begin(), index.end(),
+	    [](const IndexEntry& a, const IndexEntry& b) {
+	      return a.eventID < b.eventID; });
+
+  return true;
+}
+
+void PhaseSpaceReader::Close() {
+  if (data) munmap(const_cast<char*>(data), dataSize);
+  data = nullptr;
+  dataSize = 0;
+  index.clear();
+  nRecords = 0;
+}
+
+PhaseSpaceReader::Event PhaseSpaceReader::GetEvent(std::size_t i) const {
+  const char* first = data + sizeof(FileHeader) + index[i].firstRecord*recordSize;
+  Event event{ &index[i], nullptr, nullptr };
+  if (recordType == kDepositRecords) {
+    event.deposits = reinterpret_cast<const Deposit*>(first);
+  } else {
+    event.records = reinterpret_cast<const Record*>(first);
+  }
+  return event;
+}
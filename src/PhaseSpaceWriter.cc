@@ -0,0 +1,155 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  PhaseSpaceWriter.cc
+//
+// Description:	Singleton writers for the stage-1 phase-space file
+//		(-writePhaseSpace) and the energy-deposit file
+//		(-writeDeposits), see PhaseSpaceFormat.hh.
+
+#include "PhaseSpaceWriter.hh"
+#include "G4AutoLock.hh"
+#include "G4SystemOfUnits.hh"
+#include <cstring>
+
+using namespace PhaseSpaceFormat;
+
+
+// Constructor and Singleton Initializer
+
+PhaseSpaceWriter* PhaseSpaceWriter::theInstances[kNRecordTypes] = { 0, 0 };
+
+PhaseSpaceWriter* PhaseSpaceWriter::Instance(RecordType type) {
+  if (!theInstances[type]) {
+    theInstances[type] = new PhaseSpaceWriter(type, (type == kDepositRecords)
+					      ? sizeof(Deposit) : sizeof(Record));
+  }
+  return theInstances[type];
+}
+
+PhaseSpaceWriter::PhaseSpaceWriter(RecordType type, std::size_t size)
+  : recordType(type), recordSize(size), file(0),
+    fileMutex(G4MUTEX_INITIALIZER), nRecords(0) {;}
+
+PhaseSpaceWriter::~PhaseSpaceWriter() {
+  Close();
+}
+
+
+void PhaseSpaceWriter::Open(const G4String& name) {
+  Close();
+
+  file = std::fopen(name.c_str(), "wb");
+  if (!file) {
+    G4Exception("PhaseSpaceWriter::Open", "SNSPDPhaseSpace001", FatalException,
+		("Cannot open " + name + " for writing").c_str());
+    return;
+  }
+
+  fileName = name;
+  nRecords = 0;
+  index.clear();
+
+  FileHeader header;
+  FillHeader(header);
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fflush(file);
+
+  G4cout << "### Writing " << (recordType == kDepositRecords ? "energy deposits"
+			       : "phase space") << " to " << fileName << G4endl;
+}
+
+void PhaseSpaceWriter::FillHeader(FileHeader& header) const {
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byteOrder = kByteOrderMark;
+  header.recordType = recordType;
+  header.recordSize = recordSize;
+}
+
+// Append the event index and point the header at it
+
+void PhaseSpaceWriter::Close() {
+  if (!file) return;
+
+  FileHeader header;
+  FillHeader(header);
+  header.nRecords = nRecords;
+  header.nEvents = index.size();
+  header.indexOffset = sizeof(FileHeader) + nRecords*recordSize;
+
+  std::fseek(file, 0, SEEK_END);
+  std::fwrite(index.data(), sizeof(IndexEntry), index.size(), file);
+  std::fseek(file, 0, SEEK_SET);
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fclose(file);
+  file = 0;
+
+  G4cout << "### Wrote " << nRecords << (recordType == kDepositRecords
+					  ? " energy deposits" : " phase-space records")
+	 << " for "
+	 << index.size() << " events to " << fileName << G4endl;
+}
+
+
+void PhaseSpaceWriter::WriteEvents(const std::vector<Record>& records,
+				   const std::vector<Run::EventData>& events) {
+  WriteRecords(kParticleRecords, reinterpret_cast<const char*>(records.data()),
+	       records.size(), events);
+}
+
+void PhaseSpaceWriter::WriteEvents(const std::vector<Deposit>& deposits,
+				   const std::vector<Run::EventData>& events) {
+  WriteRecords(kDepositRecords, reinterpret_cast<const char*>(deposits.data()),
+	       deposits.size(), events);
+}
+
+void PhaseSpaceWriter::WriteRecords(RecordType type, const char* records,
+				    std::size_t count,
+				    const std::vector<Run::EventData>& events) {
+  if (!file) return;
+
+  if (type != recordType) {
+    G4Exception("PhaseSpaceWriter::WriteEvents", "SNSPDPhaseSpace005",
+		FatalException, "Records of the wrong type for this file");
+    return;
+  }
+
+  auto eventOf = [records, this](std::size_t i) {
+    std::int32_t eventID;
+    std::memcpy(&eventID, records + i*recordSize, sizeof(eventID));
+    return eventID;
+  };
+
+  G4AutoLock lock(&fileMutex);
+
+  std::size_t next = 0;
+  for (const Run::EventData& event : events) {
+    IndexEntry entry;
+    entry.eventID = event.eventID;
+    entry.firstRecord = nRecords + next;
+    entry.nRecords = 0;
+    while (next < count && eventOf(next) == event.eventID) {
+      ++entry.nRecords;
+      ++next;
+    }
+    entry.gunPosition[0] = event.gunPosition.x() / mm;
+    entry.gunPosition[1] = event.gunPosition.y() / mm;
+    entry.gunPosition[2] = event.gunPosition.z() / mm;
+    index.push_back(entry);
+  }
+
+  if (next != count) {
+    G4Exception("PhaseSpaceWriter::WriteEvents", "SNSPDPhaseSpace002",
+		JustWarning, "Phase-space records out of event order; extra"
+		" records dropped");
+  }
+
+  std::fwrite(records, recordSize, next, file);
+  std::fflush(file);
+  nRecords += next;
+}
@@ -0,0 +1,108 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  PhononImportance.cc
+//
+// Description:	Geometry importance biasing for phonon tracks, splitting
+//		them towards the wire plane and playing Russian roulette
+//		with them away from it.
+
+#include "PhononImportance.hh"
+#include "DetectorParameters.hh"
+#include "G4CMPGeometryUtils.hh"
+#include "G4CMPPhononTrackInfo.hh"
+#include "G4CMPSecondaryUtils.hh"
+#include "G4CMPTrackUtils.hh"
+#include "G4PhononPolarization.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "Randomize.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+
+// Parse "d1:I1,d2:I2,..." (um, importance), sorted by distance
+
+PhononImportance::PhononImportance(const G4String& config) {
+  std::istringstream list(config);
+  std::string cell;
+  while (std::getline(list, cell, ',')) {
+    G4double distance = 0., importance = 0.;
+    if (std::sscanf(cell.c_str(), "%lf:%lf", &distance, &importance) != 2 ||
+	importance <= 0.) {
+      G4Exception("PhononImportance", "SNSPDImportance001", FatalException,
+		  ("Bad importance cell '" + cell + "', expected"
+		   " distance_um:importance with importance > 0").c_str());
+    }
+    cells.push_back(std::make_pair(distance * um, importance));
+  }
+
+  if (cells.empty()) {
+    G4Exception("PhononImportance", "SNSPDImportance002", FatalException,
+		"Empty phonon importance map");
+  }
+
+  std::sort(cells.begin(), cells.end());
+
+  G4cout << "### Phonon importance by distance from the wire plane:";
+  for (const auto& c : cells) G4cout << " " << c.first/um << "um:" << c.second;
+  G4cout << G4endl;
+}
+
+
+G4double PhononImportance::GetImportance(const G4ThreeVector& position) const {
+  G4double distance = std::abs(position.z() - DetectorParameters::dp_wirePlaneZ);
+  for (const auto& c : cells) {
+    if (distance <= c.first) return c.second;
+  }
+  return cells.back().second;
+}
+
+
+void PhononImportance::Apply(const G4Step* step,
+			     G4TrackVector* secondaries) const {
+  G4Track* track = step->GetTrack();
+  if (track->GetTrackStatus() != fAlive) return;	// Absorbed, etc.
+
+  G4double ratio = GetImportance(step->GetPostStepPoint()->GetPosition())
+    / GetImportance(step->GetPreStepPoint()->GetPosition());
+  if (ratio == 1.) return;
+
+  if (ratio < 1.) {			// Russian roulette
+    if (G4UniformRand() < ratio) track->SetWeight(track->GetWeight() / ratio);
+    else track->SetTrackStatus(fStopAndKill);
+    return;
+  }
+
+  // Splitting: non-integer ratios are rounded randomly, keeping the mean
+  G4int nCopies = static_cast<G4int>(ratio);
+  if (G4UniformRand() < ratio - nCopies) ++nCopies;
+  if (nCopies < 2) return;
+
+  G4double weight = track->GetWeight() / nCopies;
+  track->SetWeight(weight);
+
+  // Copies carry the same wavevector, so they follow the same dispersion.
+  // The track info holds it in global coordinates; CreatePhonon expects
+  // it in the frame of the volume.
+  const G4StepPoint* postStep = step->GetPostStepPoint();
+  G4ThreeVector waveVector = G4CMP::GetLocalDirection(postStep->GetTouchable(),
+    G4CMP::GetTrackInfo<G4CMPPhononTrackInfo>(*track)->k());
+  G4int polarization = G4PhononPolarization::Get(track->GetParticleDefinition());
+
+  for (G4int i=1; i<nCopies; ++i) {
+    G4Track* copy = G4CMP::CreatePhonon(postStep->GetTouchable(), polarization,
+					waveVector, track->GetKineticEnergy(),
+					postStep->GetGlobalTime(),
+					postStep->GetPosition());
+    copy->SetWeight(weight);
+    copy->SetParentID(track->GetTrackID());
+    secondaries->push_back(copy);
+  }
+}
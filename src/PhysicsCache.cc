@@ -0,0 +1,185 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  PhysicsCache.cc
+//
+// Description:	Cache of the built physics tables (-physicsCache dir),
+//		keyed by the physics list and material configuration.
+
+#include "PhysicsCache.hh"
+#include "G4Element.hh"
+#include "G4Material.hh"
+#include "G4ProductionCuts.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4RunManager.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "G4Version.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+
+namespace {
+  // FNV-1a, as 16 hex digits
+  std::string Hash(const std::string& text) {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (unsigned char c : text) {
+      hash ^= c;
+      hash *= 0x100000001B3ULL;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx",
+		  static_cast<unsigned long long>(hash));
+    return hex;
+  }
+
+  std::string ReadFile(const std::string& name) {
+    std::ifstream in(name);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+  }
+
+  // mkdir -p
+  G4bool MakeDirectory(const std::string& dir) {
+    for (std::size_t slash = dir.find('/', 1); ;
+	 slash = dir.find('/', slash + 1)) {
+      const std::string path = dir.substr(0, slash);
+      if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) return false;
+      if (slash == std::string::npos) return true;
+    }
+  }
+
+  // The tables are stored flat in their directory
+  void RemoveDirectory(const std::string& dir) {
+    if (DIR* entries = opendir(dir.c_str())) {
+      while (const dirent* entry = readdir(entries)) {
+	const std::string name = entry->d_name;
+	if (name != "." && name != "..") unlink((dir + "/" + name).c_str());
+      }
+      closedir(entries);
+    }
+    rmdir(dir.c_str());
+  }
+}
+
+
+// One line per setting, so that key.txt also shows what a cache is for
+
+std::string PhysicsCache::Key(const G4VModularPhysicsList* physics) {
+  std::ostringstream key;
+  key.precision(17);
+
+  key << "geant4 " << G4VERSION_NUMBER << "\n";
+
+  // $G4LEDATA etc., in a fixed order
+  std::vector<std::string> dataSets;
+  for (char** var = environ; *var; ++var) {
+    const std::string setting = *var;
+    const std::size_t equals = setting.find('=');
+    if (setting.compare(0, 2, "G4") == 0 && equals >= 4 &&
+	setting.compare(equals - 4, 4, "DATA") == 0) {
+      dataSets.push_back(setting);
+    }
+  }
+  std::sort(dataSets.begin(), dataSets.end());
+  for (const std::string& setting : dataSets) key << "data " << setting << "\n";
+
+  for (G4int i = 0; const G4VPhysicsConstructor* ctor = physics->GetPhysics(i);
+       ++i) {
+    key << "physics " << ctor->GetPhysicsName() << "\n";
+  }
+
+  key << "defaultCut " << physics->GetDefaultCutValue() << "\n";
+  for (const G4Region* region : *G4RegionStore::GetInstance()) {
+    const G4ProductionCuts* cuts = region->GetProductionCuts();
+    if (!cuts) continue;
+    key << "region " << region->GetName();
+    for (G4int i = 0; i < NumberOfG4CutIndex; ++i) {
+      key << " " << cuts->GetProductionCut(i);
+    }
+    key << "\n";
+  }
+
+  for (const G4Material* material : *G4Material::GetMaterialTable()) {
+    key << "material " << material->GetName()
+	<< " " << material->GetDensity()
+	<< " " << material->GetState()
+	<< " " << material->GetTemperature()
+	<< " " << material->GetPressure();
+    const G4double* fractions = material->GetFractionVector();
+    for (std::size_t i = 0; i < material->GetNumberOfElements(); ++i) {
+      const G4Element* element = material->GetElement(i);
+      key << " " << element->GetName() << ":" << element->GetZ()
+	  << ":" << element->GetN() << ":" << fractions[i];
+    }
+    key << "\n";
+  }
+
+  return key.str();
+}
+
+
+// A new cache is filled in a directory of its own and renamed into place,
+// so jobs sharing cacheDir never see a partly stored one
+
+G4bool PhysicsCache::Prepare(G4VModularPhysicsList* physics,
+			     const G4String& cacheDir) {
+  if (cacheDir.empty()) return false;
+
+  G4RunManager* runManager = G4RunManager::GetRunManager();
+  const std::string key = Key(physics);
+  const std::string tables = cacheDir + "/" + Hash(key);
+
+  if (ReadFile(tables + "/key.txt") == key) {
+    G4cout << " ### Retrieving physics tables from " << tables << G4endl;
+    physics->SetPhysicsTableRetrieved(tables);
+    runManager->BeamOn(0);
+    return true;
+  }
+
+  G4cout << " ### Building physics tables, to be stored in " << tables
+	 << G4endl;
+  runManager->BeamOn(0);
+
+  std::string staging = tables + ".XXXXXX";
+  if (!MakeDirectory(cacheDir) || !mkdtemp(&staging[0])) {
+    G4Exception("PhysicsCache::Prepare", "SNSPDPhysicsCache001", JustWarning,
+		("Cannot create a directory in " + cacheDir
+		 + ", physics tables not stored").c_str());
+    return false;
+  }
+
+  G4bool stored = physics->StorePhysicsTable(staging);
+  if (stored) {
+    std::ofstream keyFile(staging + "/key.txt");
+    keyFile << key;
+    keyFile.close();
+    stored = !keyFile.fail();
+  }
+  if (!stored) {
+    G4Exception("PhysicsCache::Prepare", "SNSPDPhysicsCache002", JustWarning,
+		("Cannot store the physics tables in " + cacheDir).c_str());
+  }
+
+  // Another job may have stored the same configuration meanwhile
+  if (!stored || rename(staging.c_str(), tables.c_str()) != 0) {
+    RemoveDirectory(staging);
+  }
+
+  return false;
+}
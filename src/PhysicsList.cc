@@ -0,0 +1,71 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  PhysicsList.cc
+//
+// Description:	The physics list of the simulation (FTFP_BERT with G4CMP,
+//		optical, Livermore EM and step limiter physics), and the
+//		G4CMP-only list used to replay saved energy deposits.
+
+#include "PhysicsList.hh"
+#include "G4CMPPhysics.hh"
+#include "FTFP_BERT.hh"
+#include "G4OpticalPhysics.hh" // Optical physics
+#include "G4RadioactiveDecayPhysics.hh" // Radioactive decay physics
+#include "G4StepLimiterPhysics.hh" // Step limiter physics
+#include "G4EmLivermorePhysics.hh"
+#include "G4BaryonConstructor.hh"
+#include "G4BosonConstructor.hh"
+#include "G4IonConstructor.hh"
+#include "G4LeptonConstructor.hh"
+#include "G4MesonConstructor.hh"
+
+
+namespace {
+  // The standard particles are defined, without processes, so that the
+  // rest of the simulation can still refer to them by definition
+  class PhononPhysicsList : public G4VModularPhysicsList {
+  public:
+    PhononPhysicsList() { RegisterPhysics(new G4CMPPhysics); }
+
+    virtual void ConstructParticle() {
+      G4BosonConstructor().ConstructParticle();
+      G4LeptonConstructor().ConstructParticle();
+      G4MesonConstructor().ConstructParticle();
+      G4BaryonConstructor().ConstructParticle();
+      G4IonConstructor().ConstructParticle();
+      G4VModularPhysicsList::ConstructParticle();
+    }
+  };
+}
+
+
+G4VModularPhysicsList* CreatePhysicsList() {
+  G4cout<< " ### Starting Define Physics" <<G4endl;
+  FTFP_BERT* physics = new FTFP_BERT(0);
+  physics->RegisterPhysics(new G4CMPPhysics);
+
+//  physics->RegisterPhysics(new G4RadioactiveDecayPhysics); // For radioactive decay
+  physics->RegisterPhysics(new G4OpticalPhysics);
+  physics->RegisterPhysics(new G4EmLivermorePhysics); // For low energy photons
+  G4StepLimiterPhysics* stepLimitPhys = new G4StepLimiterPhysics();
+//  stepLimitPhys->SetApplyToAll(true); // activates step limit for ALL particles
+  physics->RegisterPhysics(stepLimitPhys);
+
+  physics->SetCuts();
+  G4cout<< " ### Finish Define Physics" <<G4endl;
+
+  return physics;
+}
+
+G4VModularPhysicsList* CreatePhononPhysicsList() {
+  G4cout<< " ### Starting Define Physics (G4CMP only)" <<G4endl;
+  G4VModularPhysicsList* physics = new PhononPhysicsList;
+  physics->SetCuts();
+  G4cout<< " ### Finish Define Physics" <<G4endl;
+
+  return physics;
+}
@@ -23,12 +23,46 @@
 #include "G4PhononLong.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleTable.hh"
+#include "G4IonTable.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4CMPEnergyPartition.hh"
+#include "G4RunManager.hh"
+#include "Run.hh"
+#include "EventSeed.hh"
+#include "PhaseSpaceReader.hh"
+#include "Randomize.hh"
 
 using namespace std;
 
 PrimaryGeneratorAction::PrimaryGeneratorAction(MyG4Args* MainArgs) { 
   PassArgs = MainArgs;
   fParticleGun = new G4ParticleGun(PassArgs->GetNParticles());
+
+  // Every thread maps the file itself; the mapping is shared
+  fPhaseSpace = 0;
+  if (!PassArgs->GetPhaseSpaceInput().empty()) {
+    fPhaseSpace = new PhaseSpaceReader;
+    if (!fPhaseSpace->Open(PassArgs->GetPhaseSpaceInput()) ||
+        fPhaseSpace->GetRecordType() != PhaseSpaceFormat::kParticleRecords ||
+        fPhaseSpace->GetNumEvents() == 0) {
+      G4Exception("PrimaryGeneratorAction", "SNSPDPhaseSpace003", FatalException,
+                  ("Cannot read events from " + PassArgs->GetPhaseSpaceInput()).c_str());
+    }
+  }
+
+  fDeposits = 0;
+  fPartition = 0;
+  if (PassArgs->IsDepositReplay()) {
+    fDeposits = new PhaseSpaceReader;
+    if (!fDeposits->Open(PassArgs->GetDepositInput()) ||
+        fDeposits->GetRecordType() != PhaseSpaceFormat::kDepositRecords ||
+        fDeposits->GetNumEvents() == 0) {
+      G4Exception("PrimaryGeneratorAction", "SNSPDPhaseSpace006", FatalException,
+                  ("Cannot read energy deposits from " + PassArgs->GetDepositInput()).c_str());
+    }
+    fPartition = new G4CMPEnergyPartition;
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
@@ -36,6 +70,9 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(MyG4Args* MainArgs) {
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction() {
   delete fParticleGun;
+  delete fPhaseSpace;
+  delete fDeposits;
+  delete fPartition;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
@@ -44,6 +81,28 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction() {
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
 
   G4cout<< " ### Starting Generator  " <<G4endl;
+
+  Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+
+  // Everything random in this event, including the gun position, comes
+  // from a stream fixed by (master seed, run, event); the run manager's own
+  // per-event seeding is overridden so threading does not matter
+  G4int eventID = PassArgs->GetFirstEvent() + anEvent->GetEventID();
+  long seeds[2];
+  EventSeed::Derive(PassArgs->GetMasterSeed(), run->GetRunID(), eventID, seeds);
+  EventSeed::Apply(seeds);
+  run->SetEventSeeds(seeds);
+  run->SetEventID(eventID);
+
+  if (fDeposits) {
+    GenerateDeposits(anEvent, eventID, run);
+    return;
+  }
+
+  if (fPhaseSpace) {
+    GeneratePhaseSpace(anEvent, eventID, run);
+    return;
+  }
   
   G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
 
@@ -60,15 +119,21 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
 	// Declare pos outside the if-else blocks
 	G4ThreeVector pos;
 	// Check if randomGunLocation is true or false
-	if (PassArgs->GetRandomGunLocation() || PassArgs->GetPosResScan()) {
-		pos = PassArgs->GetPosition(anEvent->GetEventID());
+	if (PassArgs->GetRandomGunLocation()) {
+    // Random X and Y between -25 and +25 microns, fixed Z at -1.525230 mm
+    // (within SiO2 substrate)
+    G4double randomX = -25.0 + G4UniformRand() * 50.0;
+    G4double randomY = -25.0 + G4UniformRand() * 50.0;
+    pos = G4ThreeVector(randomX / 1000 * mm, randomY / 1000 * mm, -1.525230 * mm);
+	} else if (PassArgs->GetPosResScan()) {
+		pos = PassArgs->GetPosition(eventID);
 	} else {
     pos = PassArgs->GetParticlePos();
 	}
 
 	// Set the particle gun position
 	fParticleGun->SetParticlePosition(pos);
-  PassArgs->StorePosition(pos);
+  run->SetGunPosition(pos);
 
   G4cout<< " ### Finshing Generator  " <<G4endl;    
   
@@ -78,4 +143,88 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
 
+// Event i replays stage-1 event i (wrapping around when there are more
+// stage-2 events), with its own seeds so the downstream physics differs
+
+void PrimaryGeneratorAction::GeneratePhaseSpace(G4Event* anEvent, G4int eventID, Run* run) {
+  PhaseSpaceReader::Event event = fPhaseSpace->GetEvent(eventID % fPhaseSpace->GetNumEvents());
+  const PhaseSpaceFormat::IndexEntry* entry = event.entry;
+
+  run->SetGunPosition(G4ThreeVector(entry->gunPosition[0], entry->gunPosition[1],
+                                    entry->gunPosition[2]) * mm);
+
+  G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
+
+  for (std::uint32_t i = 0; i < entry->nRecords; ++i) {
+    const PhaseSpaceFormat::Record& record = event.records[i];
+
+    G4ParticleDefinition* particle = particleTable->FindParticle(record.pdgCode);
+    if (!particle && record.pdgCode > 1000000000) {
+      particle = G4IonTable::GetIonTable()->GetIon(record.pdgCode);
+    }
+    if (!particle) {
+      G4Exception("PrimaryGeneratorAction::GeneratePhaseSpace", "SNSPDPhaseSpace004",
+                  JustWarning, ("No particle with PDG code " +
+                                std::to_string(record.pdgCode) + ", record skipped").c_str());
+      continue;
+    }
+
+    G4PrimaryParticle* primary = new G4PrimaryParticle(particle);
+    primary->SetKineticEnergy(record.kineticEnergy * MeV);
+    primary->SetMomentumDirection(G4ThreeVector(record.direction[0], record.direction[1],
+                                                record.direction[2]));
+    primary->SetWeight(record.weight);
+
+    G4PrimaryVertex* vertex =
+      new G4PrimaryVertex(G4ThreeVector(record.position[0], record.position[1],
+                                        record.position[2]) * mm, record.time * ns);
+    vertex->SetPrimary(primary);
+    anEvent->AddPrimaryVertex(vertex);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+
+// Events come in groups of -realizations: event i is realization
+// i % K of saved event i / K, and is recorded as that sub-event of the
+// saved event.  Every realization has its own seeds, so the partition
+// into phonons and charges, and their transport, differ between them.
+
+void PrimaryGeneratorAction::GenerateDeposits(G4Event* anEvent, G4int eventID, Run* run) {
+  const G4int nRealizations = PassArgs->GetRealizations();
+  PhaseSpaceReader::Event event =
+    fDeposits->GetEvent((eventID / nRealizations) % fDeposits->GetNumEvents());
+  const PhaseSpaceFormat::IndexEntry* entry = event.entry;
+
+  run->SetEventID(entry->eventID, eventID % nRealizations);
+  run->SetGunPosition(G4ThreeVector(entry->gunPosition[0], entry->gunPosition[1],
+                                    entry->gunPosition[2]) * mm);
+
+  for (std::uint32_t i = 0; i < entry->nRecords; ++i) {
+    const PhaseSpaceFormat::Deposit& deposit = event.deposits[i];
+    G4ThreeVector position = G4ThreeVector(deposit.position[0], deposit.position[1],
+                                           deposit.position[2]) * mm;
+
+    // Same split as G4CMPSecondaryProduction makes during the full
+    // simulation, including its downsampling (/g4cmp/producePhonons etc.)
+    fPartition->UsePosition(position);
+    fPartition->DoPartition(deposit.pdgCode, deposit.energy * MeV,
+                            deposit.nonIonizing * MeV);
+
+    G4int firstVertex = anEvent->GetNumberOfPrimaryVertex();
+    fPartition->GetPrimaries(anEvent, position, deposit.time * ns);
+
+    // Carry the weight of the depositing track (importance biasing)
+    if (deposit.weight == 1.) continue;
+    for (G4int v = firstVertex; v < anEvent->GetNumberOfPrimaryVertex(); ++v) {
+      for (G4PrimaryParticle* primary = anEvent->GetPrimaryVertex(v)->GetPrimary();
+           primary; primary = primary->GetNext()) {
+        primary->SetWeight(primary->GetWeight() * deposit.weight);
+      }
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+
 
@@ -0,0 +1,192 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  Run.cc
+//
+// Description:	Per-thread container for the hits and per-event energy
+//		sums collected during a run.  Each worker thread fills its
+//		own Run; the master merges them in RunAction.  Per-event sums
+//		are kept by particle class (ParticleCode) in a fixed array and
+//		appended to a contiguous event table when the event ends.
+//		With -profile the run also carries the stepping profile.
+//		Events replayed several times from saved energy deposits
+//		(-replayDeposits) are told apart by their sub-event number.
+//		Digitized pulses (-digitize) are buffered like the events.
+//		Hits over the -hitBufferMB budget are spilled to disk.
+
+#include "Run.hh"
+#include "HitSpool.hh"
+#include <algorithm>
+
+
+Run::Run()
+  : G4Run(), hitSpool(new HitSpool), maxBufferedHits(0), currentEvent(),
+    eventFirstHit(0), nSteps(0), nHits(0) {;}
+
+Run::~Run() {
+  delete hitSpool;
+}
+
+
+// Worker runs are merged one at a time on the master, in whatever order
+// the workers finish.  Both tables are put back in event order by
+// SortByEvent().  The master's buffer keeps to the same budget as the
+// workers', and their spilled chunks join its spool.
+
+void Run::Merge(const G4Run* aRun) {
+  const Run* localRun = static_cast<const Run*>(aRun);
+
+  hitRecords.Append(localRun->hitRecords);
+  hitSpool->Merge(*localRun->hitSpool);
+  if (maxBufferedHits > 0 && hitRecords.size() >= maxBufferedHits) {
+    SpillHits();
+  }
+
+  eventRecords.insert(eventRecords.end(), localRun->eventRecords.begin(),
+                      localRun->eventRecords.end());
+
+  phaseSpaceRecords.insert(phaseSpaceRecords.end(),
+                           localRun->phaseSpaceRecords.begin(),
+                           localRun->phaseSpaceRecords.end());
+
+  deposits.insert(deposits.end(), localRun->deposits.begin(),
+                  localRun->deposits.end());
+
+  pulses.insert(pulses.end(), localRun->pulses.begin(),
+                localRun->pulses.end());
+
+  stripPulses.insert(stripPulses.end(), localRun->stripPulses.begin(),
+                     localRun->stripPulses.end());
+
+  stepProfile.Merge(localRun->stepProfile);
+  summary.Merge(localRun->summary);
+  nSteps += localRun->nSteps;
+  nHits += localRun->nHits;
+
+  G4Run::Merge(aRun);
+}
+
+// Each event is processed by exactly one thread, so a stable sort on the
+// event ID keeps the in-event hit order and reproduces the sequential output
+
+void Run::SortByEvent() {
+  hitRecords.SortByEvent();
+
+  auto eventOrder = [](const EventData& a, const EventData& b) {
+    return (a.eventID < b.eventID ||
+            (a.eventID == b.eventID && a.subEvent < b.subEvent));
+  };
+
+  if (!std::is_sorted(eventRecords.begin(), eventRecords.end(), eventOrder)) {
+    std::sort(eventRecords.begin(), eventRecords.end(), eventOrder);
+  }
+
+  auto recordOrder = [](const PhaseSpaceFormat::Record& a,
+                        const PhaseSpaceFormat::Record& b) {
+    return a.eventID < b.eventID;
+  };
+
+  if (!std::is_sorted(phaseSpaceRecords.begin(), phaseSpaceRecords.end(),
+                      recordOrder)) {
+    std::stable_sort(phaseSpaceRecords.begin(), phaseSpaceRecords.end(),
+                     recordOrder);
+  }
+
+  auto depositOrder = [](const PhaseSpaceFormat::Deposit& a,
+                         const PhaseSpaceFormat::Deposit& b) {
+    return a.eventID < b.eventID;
+  };
+
+  if (!std::is_sorted(deposits.begin(), deposits.end(), depositOrder)) {
+    std::stable_sort(deposits.begin(), deposits.end(), depositOrder);
+  }
+
+  auto pulseOrder = [](const PulseData& a, const PulseData& b) {
+    return (a.eventID < b.eventID ||
+            (a.eventID == b.eventID && a.subEvent < b.subEvent));
+  };
+
+  if (!std::is_sorted(pulses.begin(), pulses.end(), pulseOrder)) {
+    std::sort(pulses.begin(), pulses.end(), pulseOrder);
+  }
+
+  // Strips of one event are in strip order
+  auto stripOrder = [](const StripPulse& a, const StripPulse& b) {
+    return (a.eventID < b.eventID ||
+            (a.eventID == b.eventID && a.subEvent < b.subEvent));
+  };
+
+  if (!std::is_sorted(stripPulses.begin(), stripPulses.end(), stripOrder)) {
+    std::stable_sort(stripPulses.begin(), stripPulses.end(), stripOrder);
+  }
+}
+
+void Run::ClearBuffers() {
+  hitRecords.Clear();
+  hitSpool->Clear();
+  eventRecords.clear();
+  phaseSpaceRecords.clear();
+  deposits.clear();
+  pulses.clear();
+  stripPulses.clear();
+}
+
+
+G4bool Run::HasSpilledHits() const {
+  return !hitSpool->IsEmpty();
+}
+
+void Run::SpillHits() {
+  hitSpool->Spill(hitRecords);
+}
+
+// Hits are only spilled with a budget, which also bounds the read
+
+G4bool Run::ReadSpilledHits(HitColumns& hits) {
+  return hitSpool->Read(hits, std::max<std::size_t>(maxBufferedHits, 1));
+}
+
+
+void Run::AddHitRecord(G4double energyDeposit, const G4ThreeVector& position,
+                       G4double time, G4int particleType, G4double weight,
+                       G4int trackID, const MeanderPosition& where) {
+  hitRecords.Add(currentEvent.eventID, currentEvent.subEvent, energyDeposit,
+                 position, time, particleType, weight, trackID, where.strip,
+                 where.segment, where.pathLength);
+  ++nHits;
+}
+
+void Run::EndEvent() {
+  currentEvent.energyDeposit = 0.;
+  for (G4double energy : currentEvent.energyByParticle) {
+    currentEvent.energyDeposit += energy;
+  }
+
+  // Buffers are only flushed between events, so this event's hits are
+  // the last ones
+  G4int nEventHits = 0;
+  G4double firstHitTime = 0.;
+  for (std::size_t i = eventFirstHit; i < hitRecords.size(); ++i) {
+    const G4double time = hitRecords.time[i];
+    if (nEventHits == 0 || time < firstHitTime) firstHitTime = time;
+    ++nEventHits;
+    summary.AddHitTime(time, hitRecords.weight[i]);
+  }
+
+  currentEvent.nHits = nEventHits;
+  eventRecords.push_back(currentEvent);
+
+  summary.AddEvent(currentEvent.energyDeposit, currentEvent.energyByParticle,
+                   nEventHits, firstHitTime);
+}
+
+// The event row keeps no hits to point to; the run statistics were
+// already taken from them
+
+void Run::DropEventHits() {
+  hitRecords.Resize(eventFirstHit);
+  if (!eventRecords.empty()) eventRecords.back().nHits = 0;
+}
@@ -1,11 +1,24 @@
 #include "RunAction.hh"
+#include "Run.hh"
+#include "ConfigManager.hh"
+#include "BinaryHitWriter.hh"
+#include "PhaseSpaceWriter.hh"
+#include "EventSeed.hh"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <atomic>
+#include "G4Threading.hh"
 
 using G4AnalysisManager = G4GenericAnalysisManager;
 
+namespace {
+    // Hits written so far in the run; numbers the Hits rows when there is
+    // no binary file to do it and a single thread writes them in order
+    std::atomic<unsigned long long> hitsWritten(0);
+}
+
 RunAction::RunAction(MyG4Args *MainArgs)
 { // Constructor
     
@@ -14,6 +27,11 @@ RunAction::RunAction(MyG4Args *MainArgs)
 
     G4AnalysisManager *man = G4AnalysisManager::Instance();
 
+    // In MT mode the master owns the output ntuples
+    if (G4Threading::IsMultithreadedApplication()) {
+        man->SetNtupleMerging(true);
+    }
+
     // Content of output.root (tuples created only once in the constructor)
     man->CreateNtuple("Hits","Hits");
     // Energy deposition, position (x, y, z), time, particle type
@@ -24,6 +42,13 @@ RunAction::RunAction(MyG4Args *MainArgs)
     man->CreateNtupleDColumn("Time");
     // man->CreateNtupleSColumn("ParticleType");    
     man->CreateNtupleIColumn("ParticleType");  
+    man->CreateNtupleIColumn("EventID");
+    man->CreateNtupleDColumn("Weight");
+    man->CreateNtupleIColumn("SubEvent");  // Realization (-replayDeposits), else 0
+    man->CreateNtupleIColumn("TrackID");
+    man->CreateNtupleIColumn("Strip");  // Where on the meander (see MeanderSolid.hh):
+    man->CreateNtupleIColumn("Segment");  // 2i on strip i, 2j+1 in wrap j,
+    man->CreateNtupleDColumn("PathLength");  // um along the wire
     man->FinishNtuple(0); // Finish our first tuple or Ntuple number 0
 			
     // Content of output.root (tuples created only once in the constructor)
@@ -34,30 +59,120 @@ RunAction::RunAction(MyG4Args *MainArgs)
     man->CreateNtupleDColumn("GunX");
     man->CreateNtupleDColumn("GunY");
     man->CreateNtupleDColumn("GunZ"); 
+    man->CreateNtupleIColumn("EventSeed1");  // Engine seeds of the event,
+    man->CreateNtupleIColumn("EventSeed2");  // see EventSeed.hh
+    man->CreateNtupleIColumn("SubEvent");
+    man->CreateNtupleDColumn("PhononSurvival");  // -phononBudget, see StackingAction.hh
+    // The event's hits are NHits in a row starting at FirstHit, counted
+    // from the start of the binary hit file.  Without one, FirstHit is the
+    // Hits row in sequential mode, and -1 when that is unknown (worker
+    // threads, or no Hits rows)
+    man->CreateNtupleIColumn("NHits");
+    man->CreateNtupleDColumn("FirstHit");  // Exact up to 2^53
     man->FinishNtuple(1); // Finish our first tuple or Ntuple number 0
+
+    // One row per run: what the event seeds were derived from
+    man->CreateNtuple("Run","Run");
+    man->CreateNtupleIColumn("RunID");
+    man->CreateNtupleDColumn("MasterSeed");  // Exact up to 2^53
+    man->CreateNtupleIColumn("FirstEvent");
+    man->CreateNtupleIColumn("NEvents");     // Including those without hits
+    man->FinishNtuple(2);
+
+    // Run statistics (see RunSummary.hh), one row per quantity
+    man->CreateNtuple("Summary","Summary");
+    man->CreateNtupleSColumn("Quantity");
+    man->CreateNtupleDColumn("Entries");
+    man->CreateNtupleDColumn("Mean");
+    man->CreateNtupleDColumn("StdDev");
+    man->CreateNtupleDColumn("Min");
+    man->CreateNtupleDColumn("Max");
+    for (G4double q : RunSummary::Quantiles()) {
+        man->CreateNtupleDColumn("P" + std::to_string(G4int(100.*q + 0.5)));
+    }
+    man->FinishNtuple(3);
+
+    BookHitHistograms();
+
+    // Digitized pulses (-digitize, see Digitizer.hh): one row per event,
+    // and one per strip that clicked
+    fPulseNtuple = -1;
+    fStripPulseNtuple = -1;
+    if (PassArgs->IsDigitize()) {
+        fPulseNtuple = man->CreateNtuple("Pulse","Pulse");
+        man->CreateNtupleIColumn("EventID");
+        man->CreateNtupleIColumn("SubEvent");
+        man->CreateNtupleIColumn("Detected");
+        man->CreateNtupleDColumn("FirstTime");  // ns, -1 if not detected
+        man->CreateNtupleIColumn("FirstStrip");
+        man->CreateNtupleDColumn("FirstPathLength");  // um along the wire, hotspot cell centre
+        man->CreateNtupleIColumn("NStrips");
+        man->CreateNtupleDColumn("EnergyDeposit");  // eV, weighted
+        man->FinishNtuple(fPulseNtuple);
+
+        fStripPulseNtuple = man->CreateNtuple("PulseStrips","PulseStrips");
+        man->CreateNtupleIColumn("EventID");
+        man->CreateNtupleIColumn("SubEvent");
+        man->CreateNtupleIColumn("Strip");
+        man->CreateNtupleDColumn("Time");  // ns
+        man->CreateNtupleDColumn("EnergyDeposit");  // eV, weighted
+        man->FinishNtuple(fStripPulseNtuple);
+    }
+
+    // Stepping profile (-profile), one row per (volume, particle, process)
+    fProfileNtuple = -1;
+    if (PassArgs->GetProfile()) {
+        fProfileNtuple = man->CreateNtuple("StepProfile","StepProfile");
+        man->CreateNtupleSColumn("Volume");
+        man->CreateNtupleSColumn("Particle");
+        man->CreateNtupleSColumn("Process");
+        man->CreateNtupleDColumn("Steps");
+        man->CreateNtupleDColumn("Seconds");
+        man->FinishNtuple(fProfileNtuple);
+    }
 		
 
 }
 RunAction :: ~RunAction()
 {}
 
+G4Run* RunAction::GenerateRun()
+{
+    Run* run = new Run;
+    run->SetHitBufferSize(PassArgs->GetHitBufferBytes());
+    return run;
+}
+
 void RunAction::BeginOfRunAction(const G4Run* run)
 {
+    G4AnalysisManager *man = G4AnalysisManager::Instance();
+
+    // Each configuration of a /g4cmp/scan writes its own files
+    OutputName = PassArgs->GetOutName();
+    if (!ConfigManager::GetOutputTag().empty()) {
+        OutputName += "_" + ConfigManager::GetOutputTag();
+    }
+
+    // Every event reseeds itself in PrimaryGeneratorAction; with ntuple
+    // merging a worker's OpenFile only attaches it to the master's file
+    if (!IsMaster()) {
+        man->OpenFile(("Results/" + OutputName + ".root").c_str());
+        return;
+    }
+
+    hitsWritten = 0;
+
     G4UImanager *UImanager = G4UImanager::GetUIpointer();
 
-    // Initialization of G4 random generator through computer time
-    G4int timeseed1=time(NULL);
-    G4int timeseed2=time(NULL)+128493729;
-    G4int timeseed3=time(NULL)/23839;
-    command ="/random/setSeeds "+std::to_string(timeseed1)+" "+std::to_string(timeseed2)+" "+std::to_string(timeseed3);
+    // Master engine seeded from (master seed, run); events seed themselves
+    long seeds[2];
+    EventSeed::Derive(PassArgs->GetMasterSeed(), run->GetRunID(), -1, seeds);
+    command ="/random/setSeeds "+std::to_string(seeds[0])+" "+std::to_string(seeds[1]);
     UImanager->ApplyCommand(command); 
     G4cout<<command<< G4endl;
-    G4double rand=G4UniformRand();  // Test of random number written to screen
-    G4cout<<" Random number: " << rand << G4endl;
+    G4cout<<" Master seed: " << PassArgs->GetMasterSeed() << ", run " << run->GetRunID() << G4endl;
 
 
-    G4AnalysisManager *man = G4AnalysisManager::Instance();
-
     // Get current Event number 
     G4int runID = run->GetRunID();
     std::stringstream strRunID;
@@ -74,151 +189,297 @@ void RunAction::BeginOfRunAction(const G4Run* run)
     // Creation of Output file using the OutputName from MainArgs
     std::string outputFileName = "Results/" + OutputName + ".root"; // Use OutputName for the ROOT file name
     man->OpenFile(outputFileName.c_str());
-    
-    PassArgs->ResetTotalEnergyByParticleAndEvent();
+
+    if (PassArgs->WriteBinaryHits()) {
+        BinaryHitWriter::Instance()->Open("Results/" + OutputName + ".hits",
+                                          PassArgs->GetFirstEvent(),
+                                          run->GetNumberOfEventToBeProcessed());
+    }
+
+    if (PassArgs->WritePhaseSpace()) {
+        PhaseSpaceWriter::Instance()->Open("Results/" + OutputName + ".phsp");
+    }
+
+    if (PassArgs->WriteDeposits()) {
+        PhaseSpaceWriter::Instance(PhaseSpaceFormat::kDepositRecords)->Open("Results/" + OutputName + ".deps");
+    }
 
 }
-void RunAction::EndOfRunAction(const G4Run* run)
-{
-    G4cout << "### END OF RUN" << G4endl;
 
+// Write the hits and per-event sums buffered in the run so far, then drop
+// them.  Called by EventAction every -flushEvents events, and at the end of
+// the run on the master for whatever was left (merged from the workers).
+
+void RunAction::WriteBufferedEvents(Run* run)
+{
     G4AnalysisManager* man = G4AnalysisManager::Instance();
-	if (!man) {
-		G4cout << "Error: AnalysisManager instance is null!" << G4endl;
-		return;
-	}
-    // Retrieve data from the sensitive detector (this assumes your sensitive detector is properly set up)
-    // MySensitiveDetector* sensDetector = (MySensitiveDetector*)G4SDManager::GetSDMpointer()->FindSensitiveDetector("MySensitiveDetector");
-
-    if (PassArgs) {
-        // Iterate over all hit records and store them in the ROOT file
-        const auto& hitRecords = PassArgs->GetHitRecords(); // Add a getter to MyG4Args for hitRecords
-
-	if(PassArgs->GetAllrecord()){
-    // Iterate over both vectors simultaneously
-    for (size_t i = 0; i < hitRecords.size(); ++i) {
-        const auto& hit = hitRecords[i];
-        
-            man->FillNtupleDColumn(0, 0, hit.energyDeposit);  // Energy deposit
-            man->FillNtupleDColumn(0, 1, hit.position.x() / um);   // Position X
-            man->FillNtupleDColumn(0, 2, hit.position.y() / um);   // Position Y
-            man->FillNtupleDColumn(0, 3, hit.position.z() / um);   // Position Z
-            man->FillNtupleDColumn(0, 4, hit.time);           // Time
-            // man->FillNtupleSColumn(0, 5, hit.particleType);   // Particle type
-            man->FillNtupleIColumn(0, 5, hit.particleType);   // Particle type
-               
-            man->AddNtupleRow(0);
 
-                  }
-	}else{
-   for (size_t i = 0; i < hitRecords.size(); ++i) {
-        const auto& hit = hitRecords[i];
-        
-            man->FillNtupleDColumn(0, 0, hit.energyDeposit);  // Energy deposit
-            man->FillNtupleDColumn(0, 1, hit.position.x() / um);   // Position X
-            man->FillNtupleDColumn(0, 2, hit.position.y() / um);   // Position Y
-            man->FillNtupleDColumn(0, 3, hit.position.z() / um);   // Position Z
-            man->FillNtupleDColumn(0, 4, hit.time);           // Time
-            // man->FillNtupleSColumn(0, 5, hit.particleType);   // Particle type
-            man->FillNtupleIColumn(0, 5, hit.particleType);   // Particle type
-            
-               
+    // Each flush becomes one block of the binary file, which fixes where
+    // its hits are; the events' hits follow each other from there.  The
+    // order of merged Hits rows from worker threads is not known.  Hits
+    // spilled to disk (-hitBufferMB) are read back a buffer's worth at a
+    // time, each its own block: (first hit, hits) of every block written.
+    std::vector<std::pair<G4double, size_t> > blocks;
+    auto writeHits = [this, man, &blocks](const HitColumns& hits) {
+        G4double firstHit = -1.;
+        if (PassArgs->WriteBinaryHits()) {
+            firstHit = BinaryHitWriter::Instance()->WriteBlock(hits);
+        } else if (PassArgs->WriteRootHits() &&
+                   !G4Threading::IsMultithreadedApplication()) {
+            firstHit = hitsWritten.fetch_add(hits.size());
+        }
+        blocks.push_back(std::make_pair(firstHit, hits.size()));
+
+        // The ntuple takes one row at a time, read across the columns
+        for (size_t i = 0; PassArgs->WriteRootHits() && i < hits.size(); ++i) {
+            man->FillNtupleDColumn(0, 0, hits.energyDeposit[i]);  // Energy deposit
+            man->FillNtupleDColumn(0, 1, hits.x[i] / um);   // Position X
+            man->FillNtupleDColumn(0, 2, hits.y[i] / um);   // Position Y
+            man->FillNtupleDColumn(0, 3, hits.z[i] / um);   // Position Z
+            man->FillNtupleDColumn(0, 4, hits.time[i]);     // Time
+            man->FillNtupleIColumn(0, 5, hits.particleType[i]);   // Particle type
+            man->FillNtupleIColumn(0, 6, hits.eventID[i]);  // Event the hit belongs to
+            man->FillNtupleDColumn(0, 7, hits.weight[i]);   // Track weight
+            man->FillNtupleIColumn(0, 8, hits.subEvent[i]);
+            man->FillNtupleIColumn(0, 9, hits.trackID[i]);
+            man->FillNtupleIColumn(0, 10, hits.strip[i]);
+            man->FillNtupleIColumn(0, 11, hits.segment[i]);
+            man->FillNtupleDColumn(0, 12, hits.pathLength[i] / um);
             man->AddNtupleRow(0);
+        }
+    };
+
+    // Spilled hits come back in event order, so the event table must be too
+    if (run->HasSpilledHits()) {
+        run->SortByEvent();
+        run->SpillHits();
+        HitColumns hits;
+        while (run->ReadSpilledHits(hits)) writeHits(hits);
+    } else {
+        writeHits(run->GetHitRecords());
+    }
 
-                  }
-		
-		}
+    // Records and index entries of the same events as the event table
+    if (PassArgs->WritePhaseSpace()) {
+        PhaseSpaceWriter::Instance()->WriteEvents(run->GetPhaseSpaceRecords(),
+                                                  run->GetEventRecords());
+    }
+    if (PassArgs->WriteDeposits()) {
+        PhaseSpaceWriter::Instance(PhaseSpaceFormat::kDepositRecords)->WriteEvents(run->GetDeposits(),
+                                                                                  run->GetEventRecords());
+    }
 
+    // The event table is already in event order (sorted on the master).
+    // Blocks hold whole events, so an event's hits start in the block
+    // after the last one its predecessors filled.  There is always one.
+    size_t block = 0, inBlock = 0;
+    G4double firstHit = blocks[0].first;
+    for (const auto& event : run->GetEventRecords()) {
+        while (inBlock == blocks[block].second && block + 1 < blocks.size()) {
+            firstHit = blocks[++block].first;
+            inBlock = 0;
+        }
+
+        const G4ThreeVector& gunPos = event.gunPosition;
+
+        // Print event number, the energy of every particle class that
+        // deposited any, and the gun position
+        G4cout << "Event number: " << event.eventID;
+        if (PassArgs->IsDepositReplay()) G4cout << ", realization " << event.subEvent;
+        G4cout << G4endl;
+
+        for (G4int code = 0; code < ParticleCode::kNCodes; ++code) {
+            if (event.energyByParticle[code] <= 0.) continue;
+            G4cout << "  Particle type: " << ParticleCode::Name(code) << ", "
+                   << "Total energy deposited: " << std::setprecision(8) << event.energyByParticle[code] << " eV" << G4endl;
+        }
+        if (event.energyDeposit <= 0.) {
+            G4cout << "  Particle type: none, Total energy deposited: 0 eV" << G4endl;
+        }
+        G4cout << "  Impact location (mm): X = " << gunPos.x()
+               << ", Y = " << gunPos.y()
+               << ", Z = " << gunPos.z() << G4endl;
+
+        // Fill data for the event in the N-tuple
+        man->FillNtupleIColumn(1,0, event.eventID);
+        man->FillNtupleDColumn(1,1, event.energyDeposit);
+        man->FillNtupleDColumn(1,2, gunPos.x() / mm);
+        man->FillNtupleDColumn(1,3, gunPos.y() / mm);
+        man->FillNtupleDColumn(1,4, gunPos.z() / mm);
+        man->FillNtupleIColumn(1,5, event.seeds[0]);
+        man->FillNtupleIColumn(1,6, event.seeds[1]);
+        man->FillNtupleIColumn(1,7, event.subEvent);
+        man->FillNtupleDColumn(1,8, event.phononSurvival);
+        man->FillNtupleIColumn(1,9, event.nHits);
+        man->FillNtupleDColumn(1,10, firstHit);
+        man->AddNtupleRow(1);
+
+        if (firstHit >= 0.) firstHit += event.nHits;
+        inBlock += event.nHits;
+    }
 
-        G4int lastEventNumber = run->GetNumberOfEvent() - 1;
-        G4cout << "Last event number: " << lastEventNumber << G4endl;
+    for (const auto& pulse : run->GetPulses()) {
+        man->FillNtupleIColumn(fPulseNtuple, 0, pulse.eventID);
+        man->FillNtupleIColumn(fPulseNtuple, 1, pulse.subEvent);
+        man->FillNtupleIColumn(fPulseNtuple, 2, pulse.detected);
+        man->FillNtupleDColumn(fPulseNtuple, 3, pulse.firstTime);
+        man->FillNtupleIColumn(fPulseNtuple, 4, pulse.firstStrip);
+        man->FillNtupleDColumn(fPulseNtuple, 5, pulse.firstPathLength / um);
+        man->FillNtupleIColumn(fPulseNtuple, 6, pulse.nStrips);
+        man->FillNtupleDColumn(fPulseNtuple, 7, pulse.energy);
+        man->AddNtupleRow(fPulseNtuple);
+    }
 
-		// Get the entire map for total energy by particle and event
-		const auto& totalEnergyMap = PassArgs->GetTotalEnergyByParticleAndEventAll();
-        const auto& gunpositions = PassArgs->GetGunPositions(); // Retrieve gun positions
+    for (const auto& strip : run->GetStripPulses()) {
+        man->FillNtupleIColumn(fStripPulseNtuple, 0, strip.eventID);
+        man->FillNtupleIColumn(fStripPulseNtuple, 1, strip.subEvent);
+        man->FillNtupleIColumn(fStripPulseNtuple, 2, strip.strip);
+        man->FillNtupleDColumn(fStripPulseNtuple, 3, strip.time);
+        man->FillNtupleDColumn(fStripPulseNtuple, 4, strip.energy);
+        man->AddNtupleRow(fStripPulseNtuple);
+    }
 
-		// Print the sizes of both containers
-		G4cout << "Size of totalEnergyMap: " << totalEnergyMap.size() << G4endl;
-		G4cout << "Size of gunpositions: " << gunpositions.size() << G4endl;
+    run->ClearBuffers();
+}
 
-		// Check if sizes match to ensure one-to-one correspondence
-		if (totalEnergyMap.size() != gunpositions.size()) {
-			G4cout << "Warning: Mismatch between totalEnergyMap and gunpositions sizes!" << G4endl;
-		}
-		// Initialize iterator for gunpositions
-		auto gunPosIt = gunpositions.begin();
-		
-		// Iterate through the map and fill the N-tuple
-			G4double TotEnEv = 0;
-
-		for (const auto& eventEntry : totalEnergyMap) {
-			TotEnEv = 0;
-			G4int eventNumber = eventEntry.first;  // Event number
-
-			const auto& energyByParticle = eventEntry.second;  // Energy by particle type for this event
-
-			// Check if we have a valid gun position
-			if (gunPosIt == gunpositions.end()) {
-				G4cout << "Warning: Gun positions iterator exceeded size!" << G4endl;
-				break; // Avoid out-of-bounds access
-			}
-
-			// Retrieve the gun position for this event
-			const G4ThreeVector& gunPos = *gunPosIt; // Dereference iterator
-			G4double GunX = gunPos.x();
-			G4double GunY = gunPos.y();
-			G4double GunZ = gunPos.z();
-			
+// Same names, titles and binning as AnalyzeProtonEvent in
+// AnalysisTools/SMSPD_sim_Analysis.cc
 
-			// Print event number
-			G4cout << "Event number: " << eventNumber << G4endl;
+void RunAction::BookHitHistograms()
+{
+    G4AnalysisManager* man = G4AnalysisManager::Instance();
 
-			// Iterate through the energy data for each particle type in this event
-			for (const auto& energyEntry : energyByParticle) {
-				G4cout << "  Particle type: " << energyEntry.first << ", "
-					   << "Total energy deposited: " << std::setprecision(8) << energyEntry.second << " eV" << G4endl;
-			// Print event number and gun position
-			G4cout << "  Impact location (mm): X = " << GunX
-				   << ", Y = " << GunY
-				   << ", Z = " << GunZ << G4endl;
-					   
-			}
+    const char* groupNames[kNHitGroups] = { "proton", "phonon", "phononL", "phononTS", "phononTF" };
+    const G4int nBinsEDep = 200, nBinsX = 200, nBinsY = 200, nBinsZ = 210, nBinsTime = 200;
+    const G4double eDepMin = 0., eDepMax = 0.08;
+    const G4double minX = -0.5, maxX = 0.5, minY = -0.5, maxY = 0.5, minZ = -1.6, maxZ = -0.9;
+    const G4double minTime = 0., maxTime = 20.;
+
+    for (G4int group = 0; group < kNHitGroups; ++group) {
+        const G4String name = groupNames[group];
+        HitHistograms& histograms = fHitHistograms[group];
+        histograms.eDep = man->CreateH1(name + "_eDep", "Hit EDeps; eDep [eV]; nEvents",
+                                        nBinsEDep, eDepMin, eDepMax);
+        histograms.hitXY = man->CreateH2(name + "_hitXY", "XY Locations of " + name + " Hits; X [um]; Y [um]; NHits/bin",
+                                         nBinsX, minX, maxX, nBinsY, minY, maxY);
+        histograms.hitYZ = man->CreateH2(name + "_hitYZ", "YZ Locations of " + name + " Hits; Y [um]; Z [um]; NHits/bin",
+                                         nBinsY, minY, maxY, nBinsZ, minZ, maxZ);
+        histograms.hitXZ = man->CreateH2(name + "_hitXZ", "XZ Locations of " + name + " Hits; X [um]; Z [um]; NHits/bin",
+                                         nBinsX, minX, maxX, nBinsZ, minZ, maxZ);
+        histograms.hitTime = man->CreateH1(name + "_hitTime", "Hit Global Time; Time [ns]; nEvents",
+                                           nBinsTime, minTime, maxTime);
+    }
+}
 
-			
+// Protons fill their own group; phonons fill the all-phonon group and
+// that of their polarization.  Other species are not histogrammed.
+
+void RunAction::FillHitHistograms(G4int particleType, G4double energyDeposit,
+                                  const G4ThreeVector& position, G4double time,
+                                  G4double weight) const
+{
+    if (particleType == ParticleCode::kProton) {
+        FillHitHistograms(fHitHistograms[kProtonHits], energyDeposit, position, time, weight);
+    } else if (ParticleCode::IsPhonon(particleType)) {
+        FillHitHistograms(fHitHistograms[kPhononHits], energyDeposit, position, time, weight);
+        FillHitHistograms(fHitHistograms[kPhononLHits + particleType - ParticleCode::kPhononL],
+                          energyDeposit, position, time, weight);
+    }
+}
+
+void RunAction::FillHitHistograms(const HitHistograms& histograms, G4double energyDeposit,
+                                  const G4ThreeVector& position, G4double time,
+                                  G4double weight) const
+{
+    G4AnalysisManager* man = G4AnalysisManager::Instance();
 
-			// Iterate through particle types and their associated energies in this event
-			for (const auto& energyEntry : energyByParticle) {
-				G4String particleType = energyEntry.first;       // Particle type
-				G4double energy = energyEntry.second;           // Energy for this particle type
+    const G4double x = position.x() / um, y = position.y() / um, z = position.z() / um;
+    man->FillH1(histograms.eDep, energyDeposit, weight);
+    man->FillH2(histograms.hitXY, x, y, weight);
+    man->FillH2(histograms.hitYZ, y, z, weight);
+    man->FillH2(histograms.hitXZ, x, z, weight);
+    man->FillH1(histograms.hitTime, time, weight);
+}
 
-				// Accumulate total energy for the event
-				TotEnEv += energy;
+// Print the run statistics and save them, one row per quantity
 
-			}
+void RunAction::WriteSummary(Run* run)
+{
+    G4AnalysisManager* man = G4AnalysisManager::Instance();
 
-			// Fill data for the event in the N-tuple
-			man->FillNtupleIColumn(1,0, eventNumber);
-			man->FillNtupleDColumn(1,1, TotEnEv);
-			man->FillNtupleDColumn(1,2, GunX / mm);  // Ensure GunX, GunY, GunZ are accessible
-			man->FillNtupleDColumn(1,3, GunY / mm);
-			man->FillNtupleDColumn(1,4, GunZ / mm);
-			man->AddNtupleRow(1);
-			
-			// Move to the next gun position
-			++gunPosIt;
-			
-		}
-		
-		
-    } else {
-        // If MyG4Args is not accessible, print an error message
-        G4cout << "Error: MyG4Args instance not found or accessible!" << G4endl;
+    const RunSummary& summary = run->GetSummary();
+    summary.Print(G4cout);
+
+    for (const auto& row : summary.GetRows()) {
+        const Welford& moments = row.stat->moments;
+        man->FillNtupleSColumn(3, 0, row.name);
+        man->FillNtupleDColumn(3, 1, moments.GetWeight());
+        man->FillNtupleDColumn(3, 2, moments.GetMean());
+        man->FillNtupleDColumn(3, 3, moments.GetStdDev());
+        man->FillNtupleDColumn(3, 4, moments.GetMin());
+        man->FillNtupleDColumn(3, 5, moments.GetMax());
+        G4int column = 6;
+        for (G4double q : RunSummary::Quantiles()) {
+            man->FillNtupleDColumn(3, column++, row.stat->digest.Quantile(q));
+        }
+        man->AddNtupleRow(3);
     }
+}
 
-    // Write out the ROOT file to avoid damaging it
-    man->Write();
-    man->CloseFile();
+// Print the most expensive keys and save the whole table
+
+void RunAction::WriteStepProfile(Run* run)
+{
+    G4AnalysisManager* man = G4AnalysisManager::Instance();
+
+    StepProfile& profile = run->GetStepProfile();
+    profile.Print(G4cout);
+
+    for (const auto& row : profile.GetRows()) {
+        man->FillNtupleSColumn(fProfileNtuple, 0, row.volume);
+        man->FillNtupleSColumn(fProfileNtuple, 1, row.particle);
+        man->FillNtupleSColumn(fProfileNtuple, 2, row.process);
+        man->FillNtupleDColumn(fProfileNtuple, 3, row.nSteps);
+        man->FillNtupleDColumn(fProfileNtuple, 4, row.seconds);
+        man->AddNtupleRow(fProfileNtuple);
+    }
+}
+
+void RunAction::EndOfRunAction(const G4Run* run)
+{
+    G4AnalysisManager* man = G4AnalysisManager::Instance();
+	if (!man) {
+		G4cout << "Error: AnalysisManager instance is null!" << G4endl;
+		return;
+	}
+
+    // Worker leftovers were merged into the master run before this is
+    // called, so workers only hand their ntuple rows over to the master
+    if (IsMaster()) {
+        G4cout << "### END OF RUN" << G4endl;
+
+        G4int lastEventNumber = run->GetNumberOfEvent() - 1;
+        G4cout << "Last event number: " << lastEventNumber << G4endl;
 
+        Run* masterRun = static_cast<Run*>(const_cast<G4Run*>(run));
+        masterRun->SortByEvent();
+        WriteBufferedEvents(masterRun);
+
+        man->FillNtupleIColumn(2,0, run->GetRunID());
+        man->FillNtupleDColumn(2,1, PassArgs->GetMasterSeed());
+        man->FillNtupleIColumn(2,2, PassArgs->GetFirstEvent());
+        man->FillNtupleIColumn(2,3, run->GetNumberOfEventToBeProcessed());
+        man->AddNtupleRow(2);
+
+        WriteSummary(masterRun);
+        if (PassArgs->GetProfile()) WriteStepProfile(masterRun);
+
+        if (PassArgs->WriteBinaryHits()) BinaryHitWriter::Instance()->Close();
+        if (PassArgs->WritePhaseSpace()) PhaseSpaceWriter::Instance()->Close();
+        if (PassArgs->WriteDeposits()) PhaseSpaceWriter::Instance(PhaseSpaceFormat::kDepositRecords)->Close();
+    }
+
+    // Write out the ROOT file to avoid damaging it
 	G4cout << "Finalizing ROOT file..." << G4endl;
 	man->Write();
 	man->CloseFile();
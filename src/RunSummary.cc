@@ -0,0 +1,85 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  RunSummary.cc
+//
+// Description:	Per-run statistics kept as streaming accumulators (see
+//		RunSummary.hh).
+
+#include "RunSummary.hh"
+#include <iomanip>
+#include <ostream>
+
+
+const std::vector<G4double>& RunSummary::Quantiles() {
+  static const std::vector<G4double> quantiles = { 0.05, 0.16, 0.5, 0.84, 0.95 };
+  return quantiles;
+}
+
+
+void RunSummary::Merge(const RunSummary& other) {
+  energyPerEvent.Merge(other.energyPerEvent);
+  for (G4int code=0; code<ParticleCode::kNCodes; ++code) {
+    energyByCode[code].Merge(other.energyByCode[code]);
+  }
+  multiplicity.Merge(other.multiplicity);
+  hitEfficiency.Merge(other.hitEfficiency);
+  firstHitTime.Merge(other.firstHitTime);
+  hitTime.Merge(other.hitTime);
+}
+
+
+std::vector<RunSummary::Row> RunSummary::GetRows() const {
+  std::vector<Row> rows = { { "EnergyPerEvent", &energyPerEvent } };
+  for (G4int code=0; code<ParticleCode::kNCodes; ++code) {
+    if (energyByCode[code].moments.GetMax() <= 0.) continue;
+    rows.push_back({ G4String("Energy_") + ParticleCode::Name(code),
+		     &energyByCode[code] });
+  }
+  rows.push_back({ "HitMultiplicity", &multiplicity });
+  rows.push_back({ "HitEfficiency", &hitEfficiency });
+  rows.push_back({ "FirstHitTime", &firstHitTime });
+  rows.push_back({ "HitTime", &hitTime });
+  return rows;
+}
+
+
+void RunSummary::Print(std::ostream& os) const {
+  std::ios::fmtflags oldFlags = os.flags();
+  std::streamsize oldPrecision = os.precision();
+
+  const Welford& energy = energyPerEvent.moments;
+  os << "### Run summary: " << std::setprecision(0) << std::fixed
+     << energy.GetWeight() << " events, " << std::setprecision(4)
+     << hitEfficiency.moments.GetMean() << " with hits";
+  if (energy.GetMean() > 0.) {
+    os << ", energy resolution (sigma/mean) "
+       << energy.GetStdDev() / energy.GetMean();
+  }
+  os << "\n" << std::left << std::setw(22) << "Quantity" << std::right
+     << std::setw(12) << "Entries" << std::setw(12) << "Mean"
+     << std::setw(12) << "StdDev";
+  for (G4double q : Quantiles()) {
+    os << std::setw(11) << "P" << std::setfill('0')
+       << std::setw(2) << G4int(100.*q + 0.5) << std::setfill(' ');
+  }
+  os << "\n" << std::scientific << std::setprecision(4);
+
+  for (const Row& row : GetRows()) {
+    const Welford& moments = row.stat->moments;
+    os << std::left << std::setw(22) << row.name << std::right
+       << std::setw(12) << moments.GetWeight() << std::setw(12)
+       << moments.GetMean() << std::setw(12) << moments.GetStdDev();
+    for (G4double q : Quantiles()) {
+      os << std::setw(13) << row.stat->digest.Quantile(q);
+    }
+    os << "\n";
+  }
+  os << "(energies in eV, times in ns)\n";
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
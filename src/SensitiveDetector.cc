@@ -4,6 +4,9 @@
 #include "G4Run.hh"
 #include "G4SDManager.hh"
 #include "ConfigManager.hh"
+#include "Run.hh"
+#include "RunAction.hh"
+#include "ParticleCode.hh"
 
 #include "G4SystemOfUnits.hh" // System of units for Geant4
 #include "G4PhysicsOrderedFreeVector.hh" // Class for ordered free vector of physics processes
@@ -14,6 +17,8 @@
 
 #include "G4GenericMessenger.hh" // Class for handling command-line arguments
 #include "G4TouchableHistory.hh" // Class for storing touchable history
+#include "G4LogicalVolume.hh"
+#include "G4NavigationHistory.hh"
 #include "G4ParticleDefinition.hh" // For accessing particle types
 #include "G4ThreeVector.hh" // Class for 3D vector operations
 #include <unordered_map> // For storing energy deposited by each particle type
@@ -25,63 +30,96 @@
 #include "G4PhononTransFast.hh"
 #include "G4PhononTransSlow.hh"
 #include "G4Proton.hh"
+#include "G4AntiProton.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+#include "G4PionMinus.hh"
+#include "G4PionPlus.hh"
+#include "G4Neutron.hh"
+#include <cstdlib>
 
 
 SensitiveDetector::SensitiveDetector(G4String name, MyG4Args* MainArgs): G4CMPElectrodeSensitivity(name)
 {
     PassArgs = MainArgs;
+    fRunAction = 0;
+    fMeanderVolume = 0;
+    fMeanderLayout = MeanderLayout::FromDetectorParameters();
     G4cout << "### Sensitive detector " << name << " is being created!" << G4endl;
 
+    // Particle definitions are process-wide singletons, so a pointer
+    // comparison identifies the species without touching its name
+    fParticleCodes = {
+        { G4PhononLong::Definition(),      ParticleCode::kPhononL },
+        { G4PhononTransSlow::Definition(), ParticleCode::kPhononTS },
+        { G4PhononTransFast::Definition(), ParticleCode::kPhononTF },
+        { G4Proton::Definition(),          ParticleCode::kProton },
+        { G4AntiProton::Definition(),      ParticleCode::kProton },
+        { G4Electron::Definition(),        ParticleCode::kElectron },
+        { G4Positron::Definition(),        ParticleCode::kPositron },
+        { G4Gamma::Definition(),           ParticleCode::kGamma },
+        { G4MuonMinus::Definition(),       ParticleCode::kMuon },
+        { G4MuonPlus::Definition(),        ParticleCode::kMuon },
+        { G4PionMinus::Definition(),       ParticleCode::kPion },
+        { G4PionPlus::Definition(),        ParticleCode::kPion },
+        { G4Neutron::Definition(),         ParticleCode::kNeutron },
+    };
+
+    const char* debug = getenv("G4CMP_DEBUG");
+    fDebugLevel = debug ? atoi(debug) : 0;
 }
 
 SensitiveDetector::~SensitiveDetector()
 {
 }
 
+G4int SensitiveDetector::Classify(const G4ParticleDefinition* particle) const
+{
+    for (const auto& entry : fParticleCodes) {
+        if (entry.first == particle) return entry.second;
+    }
+    return (particle->GetPDGCharge() != 0.) ? ParticleCode::kOtherCharged
+                                            : ParticleCode::kOther;
+}
+
 G4bool SensitiveDetector::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
 {
-	
-    
+    // Get particle type (the track associated with the step)
+    G4int intParticleType = Classify(aStep->GetTrack()->GetDefinition());
+    G4bool isPhonon = ParticleCode::IsPhonon(intParticleType);
+
     // Only process hits where energy deposition is greater than 0
-    if (IsHit(aStep, ROhist)) {
+    if (IsHit(aStep, isPhonon)) {
 
-        G4double edep = GetEnergyDep(aStep) / eV;
+        G4double edep = GetEnergyDep(aStep, isPhonon) / eV;
         
         // Get position of the hit
         G4ThreeVector position = aStep->GetPostStepPoint()->GetPosition();
         
         // Get the time of the hit (time at the post step point)
         G4double time = aStep->GetPostStepPoint()->GetGlobalTime() / ns;
-        
-        // Get particle type (the track associated with the step)
-        G4Track *track = aStep->GetTrack();
-        G4ParticleDefinition *particle = track->GetDefinition();
-        G4String particleType = particle->GetParticleName();
-        G4int intParticleType;
-        if (particleType.find("proton") != std::string::npos) {
-            intParticleType = 0;
-        } else if (particleType.find("phononL") != std::string::npos) {
-            intParticleType = 1;
-        } else if (particleType.find("phononTS") != std::string::npos) {
-            intParticleType = 2;
-        } else if (particleType.find("phononTF") != std::string::npos) {
-            intParticleType = 3;
-        }
-
-        // G4cout << particleType << G4endl;
-        // G4cout << "edep = " << edep / eV << " eV" << G4endl;
-        // G4cout << "time = " << time / ns << " ns" << G4endl;
-        // G4cout << "-----------------------------" << G4endl;
-        
-        
-        // Store the hit data
-		PassArgs->AddHitRecord(edep, position, time, intParticleType);
 
-		// Get the event number
-        G4int eventNumber = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
-        
-		PassArgs->AddToEnergyByParticleAndEvent(particleType, edep, eventNumber);
-		PassArgs->AddCurrentEvtEdep(edep);
+        // Hits go to this thread's run, merged on the master at end of run
+        G4RunManager* runManager = G4RunManager::GetRunManager();
+        Run* run = static_cast<Run*>(runManager->GetNonConstCurrentRun());
+
+        // Store the hit data under the run's current event (and sub-event)
+        // Weighted sums stay unbiased under phonon importance biasing
+        G4double weight = aStep->GetTrack()->GetWeight();
+		run->AddHitRecord(edep, position, time, intParticleType, weight,
+		                  aStep->GetTrack()->GetTrackID(),
+		                  Locate(aStep->GetPostStepPoint()));
+		run->AddEnergyDeposit(intParticleType, edep * weight);
+
+        // This thread's run action, which books the histograms; only known
+        // once the user actions have been built
+        if (!fRunAction) {
+            fRunAction = static_cast<const RunAction*>(runManager->GetUserRunAction());
+        }
+        fRunAction->FillHitHistograms(intParticleType, edep, position, time, weight);
 		
     }
 
@@ -89,14 +127,25 @@ G4bool SensitiveDetector::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
     return true;
 }
 
-G4double SensitiveDetector::GetEnergyDep(const G4Step* step)
+// The meander's layout is looked up again only when the hit volume
+// changes, or after a rebuild (see SetTargetVolumes)
+
+MeanderPosition SensitiveDetector::Locate(const G4StepPoint* point)
 {
-    //Establish track/step information
-    const G4Track* track = step->GetTrack();
-    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
-    const G4ParticleDefinition* particle = track->GetDefinition();
-    G4bool isPhonon = G4CMP::IsPhonon(particle);
+    const G4VPhysicalVolume* volume = point->GetPhysicalVolume();
+    if (volume != fMeanderVolume) {
+        const MeanderSolid* meander =
+            dynamic_cast<const MeanderSolid*>(volume->GetLogicalVolume()->GetSolid());
+        fMeanderLayout = meander ? meander->GetLayout() : MeanderLayout::FromDetectorParameters();
+        fMeanderVolume = volume;
+    }
 
+    const G4AffineTransform& toLocal = point->GetTouchable()->GetHistory()->GetTopTransform();
+    return fMeanderLayout.Locate(toLocal.TransformPoint(point->GetPosition()));
+}
+
+G4double SensitiveDetector::GetEnergyDep(const G4Step* step, G4bool isPhonon) const
+{
     if (isPhonon) {
         return step->GetNonIonizingEnergyDeposit();
     }else {
@@ -106,6 +155,11 @@ G4double SensitiveDetector::GetEnergyDep(const G4Step* step)
 
 G4bool SensitiveDetector::IsHit(const G4Step* step,
     const G4TouchableHistory*) const
+{
+    return IsHit(step, G4CMP::IsPhonon(step->GetTrack()->GetDefinition()));
+}
+
+G4bool SensitiveDetector::IsHit(const G4Step* step, G4bool isPhonon) const
 {
 
     //Establish track/step information
@@ -113,16 +167,15 @@ G4bool SensitiveDetector::IsHit(const G4Step* step,
     const G4StepPoint* postStepPoint = step->GetPostStepPoint();
     const G4ParticleDefinition* particle = track->GetDefinition();
 
-    G4bool isPhonon = G4CMP::IsPhonon(particle);
     G4bool deadAtBoundary = (
         step->GetTrack()->GetTrackStatus() == fStopAndKill &&
         postStepPoint->GetStepStatus() == fGeomBoundary
     );
-    G4bool landedOnTargetSurface = (postStepPoint->GetPhysicalVolume()->GetName().find("WSiWire") != std::string::npos);
+    G4bool landedOnTargetSurface = (fTargetVolumes.count(postStepPoint->GetPhysicalVolume()) > 0);
     G4bool depositedNonzeroNonIonizingEnergy = step->GetNonIonizingEnergyDeposit() > 0.;
     G4bool depositedNonzeroEnergy = step->GetTotalEnergyDeposit() > 0.;
 
-    if (getenv("G4CMP_DEBUG") != nullptr && atoi(getenv("G4CMP_DEBUG")) > 0)
+    if (fDebugLevel > 0)
     {
         if (isPhonon) {
             G4cout<<"### Detected " << std::setprecision(8) << step->GetNonIonizingEnergyDeposit() * 1e6 << " eV hit by "<< particle->GetParticleName() << " @ " << particle <<" of energy " << track->GetKineticEnergy() * 1e6 << " eV, will it be recorded? "<< (deadAtBoundary && depositedNonzeroNonIonizingEnergy) <<G4endl;
@@ -0,0 +1,122 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  StackingAction.cc
+//
+// Description:	G4CMP stacking with a per-event phonon budget (see
+//		StackingAction.hh).
+
+#include "StackingAction.hh"
+#include "Run.hh"
+#include "G4CMPProcessSubType.hh"
+#include "G4CMPUtils.hh"
+#include "G4RunManager.hh"
+#include "G4StackManager.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "Randomize.hh"
+
+
+StackingAction::StackingAction(MyG4Args* MainArgs)
+  : G4CMPStackingAction(), phononBudget(MainArgs->GetPhononBudget()),
+    lukeBudget(MainArgs->GetLukeBudget()), promptStage(true),
+    releasing(false), nPrompt{0, 0}, promptSurvival{1., 1.}, nLuke(0) {;}
+
+
+void StackingAction::PrepareNewEvent() {
+  G4CMPStackingAction::PrepareNewEvent();
+
+  promptStage = true;
+  releasing = false;
+  for (G4int kind=0; kind<kNPromptKinds; ++kind) {
+    nPrompt[kind] = 0;
+    promptSurvival[kind] = 1.;
+  }
+  nLuke = 0;
+
+  // Before BeginOfEventAction, which keeps it
+  Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  if (run) run->SetPhononSurvival(1.);
+}
+
+
+// G4CMP sets up its tracks once, when they are first stacked; held tracks
+// come back here from ReClassify() already set up
+
+G4ClassificationOfNewTrack
+StackingAction::ClassifyNewTrack(const G4Track* track) {
+  if (releasing) {
+    G4int kind = G4CMP::IsPhonon(track) ? kPhonons : kCharges;
+    return Roulette(track, promptSurvival[kind], fUrgent);
+  }
+
+  G4ClassificationOfNewTrack classification =
+    G4CMPStackingAction::ClassifyNewTrack(track);
+  if (classification == fKill) return classification;
+
+  G4bool isPhonon = G4CMP::IsPhonon(track);
+  if (!isPhonon && !G4CMP::IsChargeCarrier(track)) return classification;
+
+  if (promptStage && phononBudget > 0) {
+    ++nPrompt[isPhonon ? kPhonons : kCharges];
+    return fWaiting;
+  }
+
+  if (isPhonon && lukeBudget > 0 && IsLukePhonon(track)) {
+    ++nLuke;
+    return Roulette(track, Survival(lukeBudget, nLuke), classification);
+  }
+
+  return classification;
+}
+
+
+// Everything but the held G4CMP tracks has been tracked, so the event's
+// prompt phonon and charge counts are known
+
+void StackingAction::NewStage() {
+  G4CMPStackingAction::NewStage();
+
+  if (!promptStage) return;
+  promptStage = false;
+  if (phononBudget <= 0) return;
+
+  for (G4int kind=0; kind<kNPromptKinds; ++kind) {
+    promptSurvival[kind] = Survival(phononBudget, nPrompt[kind]);
+  }
+
+  Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  run->SetPhononSurvival(promptSurvival[kPhonons]);
+
+  if (promptSurvival[kPhonons] < 1. || promptSurvival[kCharges] < 1.) {
+    G4cout << " ### Phonon budget: keeping " << promptSurvival[kPhonons]
+	   << " of " << nPrompt[kPhonons] << " phonons and "
+	   << promptSurvival[kCharges] << " of " << nPrompt[kCharges]
+	   << " charges" << G4endl;
+  }
+
+  // The held tracks were moved to the urgent stack before this call
+  releasing = true;
+  stackManager->ReClassify();
+  releasing = false;
+}
+
+
+G4ClassificationOfNewTrack
+StackingAction::Roulette(const G4Track* track, G4double survival,
+			 G4ClassificationOfNewTrack keep) const {
+  if (survival >= 1.) return keep;
+  if (G4UniformRand() >= survival) return fKill;
+
+  const_cast<G4Track*>(track)->SetWeight(track->GetWeight() / survival);
+  return keep;
+}
+
+G4bool StackingAction::IsLukePhonon(const G4Track* track) const {
+  const G4VProcess* creator = track->GetCreatorProcess();
+  return (creator && creator->GetProcessType() == fPhonon &&
+	  creator->GetProcessSubType() == fLukeScattering);
+}
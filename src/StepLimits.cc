@@ -0,0 +1,118 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  StepLimits.cc
+//
+// Description:	Maximum step lengths by particle class and by distance from
+//		the wire plane (see StepLimits.hh).
+
+#include "StepLimits.hh"
+#include "DetectorParameters.hh"
+#include "G4Electron.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+#include "G4Positron.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+
+// The limits formerly set on the substrate and wire for every particle
+
+const G4String& StepLimits::DefaultSpec() {
+  static const G4String spec = "substrate:all:50,wire:all:0.05";
+  return spec;
+}
+
+
+// Parse "volume:class:step_nm[:within_um],..."
+
+StepLimits::StepLimits(const G4String& volume, const G4String& spec)
+  : G4UserLimits("StepLimits_" + volume) {
+  std::istringstream list(spec);
+  std::string entry;
+  while (std::getline(list, entry, ',')) {
+    char entryVolume[32] = "", entryClass[32] = "";
+    G4double step = 0., within = -1.;
+    G4int nRead = std::sscanf(entry.c_str(), "%31[^:]:%31[^:]:%lf:%lf",
+			      entryVolume, entryClass, &step, &within);
+
+    G4String volumeName = entryVolume, className = entryClass;
+    if (nRead < 3 || step <= 0. || (nRead == 4 && within <= 0.) ||
+	(volumeName != "substrate" && volumeName != "wire")) {
+      G4Exception("StepLimits", "SNSPDStepLimit001", FatalException,
+		  ("Bad step limit '" + entry + "', expected"
+		   " substrate|wire:class:step_nm[:within_um]").c_str());
+      continue;
+    }
+    if (volumeName != volume) continue;
+
+    std::pair<G4double, G4double> limit((nRead == 4) ? within*um : DBL_MAX,
+					step*nm);
+    if (className == "all") {
+      for (auto& classLimits : limits) classLimits.push_back(limit);
+    } else if (className == "electron") {
+      limits[kElectron].push_back(limit);
+    } else if (className == "muon") {
+      limits[kMuon].push_back(limit);
+    } else if (className == "hadron") {
+      limits[kHadron].push_back(limit);
+    } else {
+      G4Exception("StepLimits", "SNSPDStepLimit002", FatalException,
+		  ("Unknown particle class '" + className + "' in step limit,"
+		   " expected electron, muon, hadron or all").c_str());
+    }
+  }
+
+  for (auto& classLimits : limits) {
+    std::sort(classLimits.begin(), classLimits.end());
+  }
+
+  G4cout << "### Step limits in " << volume << ":";
+  const char* classNames[kNClasses] = { "electron", "muon", "hadron", "neutral" };
+  for (G4int i=0; i<kNClasses; ++i) {
+    for (const auto& limit : limits[i]) {
+      G4cout << " " << classNames[i] << " " << limit.second/nm << "nm";
+      if (limit.first < DBL_MAX) G4cout << " within " << limit.first/um << "um";
+    }
+  }
+  G4cout << G4endl;
+}
+
+
+StepLimits::ParticleClass StepLimits::Classify(const G4Track& track) const {
+  const G4ParticleDefinition* particle = track.GetParticleDefinition();
+  if (particle == G4Electron::Definition() ||
+      particle == G4Positron::Definition()) return kElectron;
+  if (particle == G4MuonMinus::Definition() ||
+      particle == G4MuonPlus::Definition()) return kMuon;
+  return (particle->GetPDGCharge() != 0.) ? kHadron : kNeutral;
+}
+
+
+// Limits whose region contains the track apply directly; a finer region
+// ahead caps the step at the distance to its edge
+
+G4double StepLimits::GetMaxAllowedStep(const G4Track& track) {
+  const auto& classLimits = limits[Classify(track)];
+  if (classLimits.empty()) return DBL_MAX;
+
+  G4double distance =
+    std::abs(track.GetPosition().z() - DetectorParameters::dp_wirePlaneZ);
+
+  G4double maxStep = DBL_MAX;
+  for (const auto& limit : classLimits) {
+    if (distance <= limit.first) maxStep = std::min(maxStep, limit.second);
+    else maxStep = std::min(maxStep, std::max(distance - limit.first,
+					       limit.second));
+  }
+
+  return maxStep;
+}
@@ -0,0 +1,145 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  StepProfile.cc
+//
+// Description:	Step counts and wall time by (physical volume, particle,
+//		process that limited the step), filled by SteppingAction
+//		when -profile is given.
+
+#include "StepProfile.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VProcess.hh"
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+
+
+StepProfile::StepProfile()
+  : lastKey{nullptr, nullptr, nullptr}, lastCounts(nullptr),
+    lastTime(Clock::now()) {;}
+
+
+std::size_t StepProfile::KeyHash::operator()(const Key& key) const {
+  std::hash<const void*> hash;
+  std::size_t seed = hash(key.volume);
+  seed ^= hash(key.particle) + 0x9e3779b97f4a7c15ULL + (seed<<6) + (seed>>2);
+  seed ^= hash(key.process) + 0x9e3779b97f4a7c15ULL + (seed<<6) + (seed>>2);
+  return seed;
+}
+
+
+// Hot path: one clock read and, unless the key repeats, one hash lookup.
+// Map nodes never move, so lastCounts stays valid across insertions.
+
+void StepProfile::Record(const G4Step* step) {
+  Clock::time_point now = Clock::now();
+  G4double seconds = std::chrono::duration<G4double>(now - lastTime).count();
+  lastTime = now;
+
+  Key key{ step->GetPreStepPoint()->GetPhysicalVolume(),
+	   step->GetTrack()->GetParticleDefinition(),
+	   step->GetPostStepPoint()->GetProcessDefinedStep() };
+
+  if (!lastCounts || !(key == lastKey)) {
+    lastCounts = &byPointer.emplace(key, Counts{0., 0.}).first->second;
+    lastKey = key;
+  }
+
+  lastCounts->nSteps += 1.;
+  lastCounts->seconds += seconds;
+}
+
+
+StepProfile::Names StepProfile::NamesOf(const Key& key) {
+  return Names(key.volume ? key.volume->GetName() : G4String("none"),
+	       key.particle ? key.particle->GetParticleName() : G4String("none"),
+	       key.process ? key.process->GetProcessName() : G4String("none"));
+}
+
+void StepProfile::AddByName(const Names& names, const Counts& counts) {
+  Counts& total = byName.emplace(names, Counts{0., 0.}).first->second;
+  total.nSteps += counts.nSteps;
+  total.seconds += counts.seconds;
+}
+
+// Called on the master while the worker's processes still exist
+
+void StepProfile::Merge(const StepProfile& other) {
+  for (const auto& entry : other.byPointer) {
+    AddByName(NamesOf(entry.first), entry.second);
+  }
+  for (const auto& entry : other.byName) {
+    AddByName(entry.first, entry.second);
+  }
+}
+
+void StepProfile::Clear() {
+  byPointer.clear();
+  byName.clear();
+  lastCounts = nullptr;
+}
+
+
+std::vector<StepProfile::Row> StepProfile::GetRows() const {
+  StepProfile folded;
+  folded.Merge(*this);
+
+  std::vector<Row> rows;
+  rows.reserve(folded.byName.size());
+  for (const auto& entry : folded.byName) {
+    rows.push_back({ std::get<0>(entry.first), std::get<1>(entry.first),
+		     std::get<2>(entry.first), entry.second.nSteps,
+		     entry.second.seconds });
+  }
+
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+      return a.seconds > b.seconds; });
+  return rows;
+}
+
+void StepProfile::Print(std::ostream& os, std::size_t maxRows) const {
+  std::vector<Row> rows = GetRows();
+
+  G4double totalSteps = 0., totalSeconds = 0.;
+  for (const Row& row : rows) {
+    totalSteps += row.nSteps;
+    totalSeconds += row.seconds;
+  }
+
+  std::ios::fmtflags oldFlags = os.flags();
+  std::streamsize oldPrecision = os.precision();
+
+  os << "### Step profile: " << std::setprecision(0) << std::fixed
+     << totalSteps << " steps, " << std::setprecision(3) << totalSeconds
+     << " s in " << rows.size() << " (volume, particle, process) keys\n"
+     << std::left << std::setw(24) << "Volume" << std::setw(16) << "Particle"
+     << std::setw(24) << "Process" << std::right << std::setw(14) << "Steps"
+     << std::setw(12) << "Seconds" << std::setw(8) << "%Time"
+     << std::setw(12) << "us/step" << "\n";
+
+  for (std::size_t i=0; i<rows.size() && i<maxRows; ++i) {
+    const Row& row = rows[i];
+    os << std::left << std::setw(24) << row.volume << std::setw(16)
+       << row.particle << std::setw(24) << row.process << std::right
+       << std::setprecision(0) << std::setw(14) << row.nSteps
+       << std::setprecision(3) << std::setw(12) << row.seconds
+       << std::setprecision(1) << std::setw(8)
+       << (totalSeconds > 0. ? 100.*row.seconds/totalSeconds : 0.)
+       << std::setprecision(3) << std::setw(12)
+       << (row.nSteps > 0. ? 1e6*row.seconds/row.nSteps : 0.) << "\n";
+  }
+
+  if (rows.size() > maxRows) {
+    os << "(" << rows.size() - maxRows << " more keys in the StepProfile ntuple)\n";
+  }
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
@@ -7,6 +7,9 @@
 // Basic User Stepping action for the silicon six qubit array (mostly for debugging)
 
 #include "SteppingAction.hh"
+#include "DetectorConstruction.hh"
+#include "PhononImportance.hh"
+#include "Run.hh"
 #include <iostream>
 #include "globals.hh"
 #include "G4Run.hh"
@@ -15,8 +18,13 @@
 #include "G4Threading.hh"
 
 #include "G4RunManager.hh"
+#include "G4SteppingManager.hh"
+#include "G4CMPUtils.hh"
+#include "G4LatticeManager.hh"
 #include "G4StepPoint.hh"
 #include "G4VSensitiveDetector.hh"
+#include "G4Event.hh"
+#include "G4SystemOfUnits.hh"
 
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
@@ -28,6 +36,14 @@ SteppingAction::SteppingAction(MyG4Args* MainArgs)
   //fOutputFile.open("StepInformationFile.txt",std::ios::trunc);
 
   PassArgs = MainArgs;
+
+  fPhaseSpaceVolumes = 0;
+  fDepositVolume = 0;
+  fDepositVolumeHasLattice = false;
+  fImportance = 0;
+  if (!PassArgs->GetPhononImportance().empty()) {
+    fImportance = new PhononImportance(PassArgs->GetPhononImportance());
+  }
   
 }
 
@@ -35,6 +51,7 @@ SteppingAction::SteppingAction(MyG4Args* MainArgs)
 SteppingAction::~SteppingAction()
 {
   //fOutputFile.close();
+  delete fImportance;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
@@ -47,16 +64,119 @@ void SteppingAction::UserSteppingAction( const G4Step* step )
   //First up: do generic exporting of step information (no cuts made here)
   //ExportStepInformation(step);
 
+  Run* run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  run->CountStep();
+  if (PassArgs->GetProfile()) run->GetStepProfile().Record(step);
+
+  // Phonon sources for a later -replayDeposits pass
+  if (PassArgs->WriteDeposits() && step->GetTotalEnergyDeposit() > 0.) {
+    RecordDeposit(step, run);
+  }
+
   G4double globalTime = step->GetTrack()->GetGlobalTime();
   if (PassArgs->GetTimeCut(globalTime)) {
     step->GetTrack()->SetTrackStatus(fStopAndKill);
   }
+
+  // Stage 1 stops here: whatever reaches the housing is saved for stage 2
+  if (PassArgs->WritePhaseSpace() && step->GetTrack()->GetTrackStatus() == fAlive) {
+    const G4StepPoint* point = GetPhaseSpacePoint(step);
+    if (point) {
+      RecordPhaseSpace(step, point, run);
+      step->GetTrack()->SetTrackStatus(fStopAndKill);
+      return;
+    }
+  }
+
+  // Split phonons heading for the wire, roulette those leaving it; copies
+  // go to the stack with this track's other secondaries
+  if (fImportance && G4CMP::IsPhonon(step->GetTrack())) {
+    fImportance->Apply(step, fpSteppingManager->GetfSecondary());
+  }
   
   return;
 }
 
 
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+// Boundary steps into the housing or substrate from outside, and first
+// steps of tracks starting inside them (e.g. a gun placed in the chip)
+const G4StepPoint* SteppingAction::GetPhaseSpacePoint(const G4Step* step)
+{
+  // The volume set is shared with (and filled by) the detector construction
+  if (!fPhaseSpaceVolumes) {
+    fPhaseSpaceVolumes = &static_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction())->GetPhaseSpaceVolumes();
+  }
+
+  const G4StepPoint* preSP = step->GetPreStepPoint();
+  const G4StepPoint* postSP = step->GetPostStepPoint();
+  G4bool preInside = fPhaseSpaceVolumes->count(preSP->GetPhysicalVolume()) > 0;
+
+  if (step->GetTrack()->GetCurrentStepNumber() == 1 && preInside) return preSP;
+
+  if (postSP->GetStepStatus() == fGeomBoundary && !preInside &&
+      fPhaseSpaceVolumes->count(postSP->GetPhysicalVolume()) > 0) {
+    return postSP;
+  }
+
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+void SteppingAction::RecordPhaseSpace(const G4Step* step, const G4StepPoint* point, Run* run)
+{
+  const G4Track* track = step->GetTrack();
+  const G4ThreeVector& position = point->GetPosition();
+  const G4ThreeVector& direction = point->GetMomentumDirection();
+
+  PhaseSpaceFormat::Record record;
+  record.eventID = run->GetEventID();
+  record.pdgCode = track->GetParticleDefinition()->GetPDGEncoding();
+  for (G4int i=0; i<3; ++i) {
+    record.position[i] = position[i] / mm;
+    record.direction[i] = direction[i];
+  }
+  record.kineticEnergy = point->GetKineticEnergy() / MeV;
+  record.time = point->GetGlobalTime() / ns;
+  record.weight = point->GetWeight();
+
+  run->AddPhaseSpaceRecord(record);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
+// Energy left in a lattice by anything G4CMP does not transport itself;
+// these are the deposits G4CMP turns into phonons and charge pairs
+void SteppingAction::RecordDeposit(const G4Step* step, Run* run)
+{
+  const G4Track* track = step->GetTrack();
+  if (G4CMP::IsPhonon(track) || G4CMP::IsChargeCarrier(track)) return;
+
+  // Steps in one volume come in runs, so the lattice lookup is cached
+  G4VPhysicalVolume* volume = step->GetPreStepPoint()->GetPhysicalVolume();
+  if (volume != fDepositVolume) {
+    fDepositVolume = volume;
+    fDepositVolumeHasLattice = G4LatticeManager::GetLatticeManager()->HasLattice(volume);
+  }
+  if (!fDepositVolumeHasLattice) return;
+
+  const G4StepPoint* preSP = step->GetPreStepPoint();
+  const G4StepPoint* postSP = step->GetPostStepPoint();
+  G4ThreeVector position = 0.5 * (preSP->GetPosition() + postSP->GetPosition());
+
+  PhaseSpaceFormat::Deposit deposit;
+  deposit.eventID = run->GetEventID();
+  deposit.pdgCode = track->GetParticleDefinition()->GetPDGEncoding();
+  for (G4int i=0; i<3; ++i) deposit.position[i] = position[i] / mm;
+  deposit.energy = step->GetTotalEnergyDeposit() / MeV;
+  deposit.nonIonizing = step->GetNonIonizingEnergyDeposit() / MeV;
+  deposit.time = 0.5 * (preSP->GetGlobalTime() + postSP->GetGlobalTime()) / ns;
+  deposit.weight = track->GetWeight();
+
+  run->AddDeposit(deposit);
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo....
 // Do a set of queries of information to test for anharmonic decay
 void SteppingAction::ExportStepInformation( const G4Step* step )
@@ -0,0 +1,167 @@
+/***********************************************************************\
+ * This software is licensed under the terms of the GNU General Public *
+ * License version 3 or later. See G4CMP/LICENSE for the full license. *
+\***********************************************************************/
+
+// $Id$
+// File:  StreamingStats.cc
+//
+// Description:	Mergeable one-pass accumulators of fixed size (see
+//		StreamingStats.hh).
+
+#include "StreamingStats.hh"
+#include <algorithm>
+#include <cmath>
+
+
+// West's weighted form of Welford's update
+
+void Welford::Add(double x, double w) {
+  if (w <= 0.) return;
+
+  if (weight == 0.) {
+    min = max = x;
+  } else {
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  weight += w;
+  double delta = x - mean;
+  mean += delta * w / weight;
+  m2 += w * delta * (x - mean);
+}
+
+// Chan et al.'s pairwise combination
+
+void Welford::Merge(const Welford& other) {
+  if (other.weight == 0.) return;
+  if (weight == 0.) {
+    *this = other;
+    return;
+  }
+
+  double total = weight + other.weight;
+  double delta = other.mean - mean;
+  mean += delta * other.weight / total;
+  m2 += other.m2 + delta * delta * weight * other.weight / total;
+  weight = total;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+double Welford::GetVariance() const {
+  return (weight > 1.) ? m2 / (weight - 1.) : 0.;
+}
+
+double Welford::GetStdDev() const {
+  return std::sqrt(GetVariance());
+}
+
+
+TDigest::TDigest(double compression)
+  : compression(compression), min(0.), max(0.), totalWeight(0.),
+    bufferWeight(0.) {;}
+
+void TDigest::Add(double x, double w) {
+  if (w <= 0.) return;
+
+  if (GetWeight() == 0.) {
+    min = max = x;
+  } else {
+    min = std::min(min, x);
+    max = std::max(max, x);
+  }
+
+  buffer.push_back({x, w});
+  bufferWeight += w;
+  if (buffer.size() >= 5*compression) Compress();
+}
+
+void TDigest::Merge(const TDigest& other) {
+  if (other.GetWeight() == 0.) return;
+
+  if (GetWeight() == 0.) {
+    min = other.min;
+    max = other.max;
+  } else {
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+
+  buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+  buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+  bufferWeight += other.totalWeight + other.bufferWeight;
+  Compress();
+}
+
+// k(q) grows fastest near q = 0 and 1, so centroids there stay small
+
+double TDigest::ScaleK(double q) const {
+  return compression / (2.*M_PI) * std::asin(2.*q - 1.);
+}
+
+void TDigest::Compress() const {
+  if (buffer.empty()) return;
+
+  buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+  std::sort(buffer.begin(), buffer.end(),
+	    [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+
+  const double total = totalWeight + bufferWeight;
+  centroids.clear();
+
+  // Merge neighbours while the centroid spans at most one unit of k
+  Centroid current = buffer[0];
+  double before = 0.;			// Weight left of current
+  double kLeft = ScaleK(0.);
+  for (std::size_t i=1; i<buffer.size(); ++i) {
+    const Centroid& next = buffer[i];
+    double qRight = std::min(1., (before + current.weight + next.weight) / total);
+    if (ScaleK(qRight) - kLeft <= 1.) {
+      current.weight += next.weight;
+      current.mean += (next.mean - current.mean) * next.weight / current.weight;
+    } else {
+      centroids.push_back(current);
+      before += current.weight;
+      kLeft = ScaleK(std::min(1., before / total));
+      current = next;
+    }
+  }
+  centroids.push_back(current);
+
+  buffer.clear();
+  totalWeight = total;
+  bufferWeight = 0.;
+}
+
+// Linear interpolation between centroid centres, each centroid holding
+// half its weight on either side; the tails run out to min and max
+
+double TDigest::Quantile(double q) const {
+  Compress();
+  if (centroids.empty()) return 0.;
+  if (centroids.size() == 1) return min + q * (max - min);
+
+  q = std::max(0., std::min(1., q));
+  const double index = q * totalWeight;
+
+  const Centroid& first = centroids.front();
+  if (index < first.weight / 2.) {
+    return min + (first.mean - min) * index / (first.weight / 2.);
+  }
+
+  double cumulative = first.weight / 2.;
+  for (std::size_t i=0; i+1<centroids.size(); ++i) {
+    double step = (centroids[i].weight + centroids[i+1].weight) / 2.;
+    if (cumulative + step > index) {
+      double t = (index - cumulative) / step;
+      return centroids[i].mean + t * (centroids[i+1].mean - centroids[i].mean);
+    }
+    cumulative += step;
+  }
+
+  const Centroid& last = centroids.back();
+  double t = std::min(1., (index - cumulative) / (last.weight / 2.));
+  return last.mean + t * (max - last.mean);
+}